@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+
+"""Compile-time benchmark of vsopc
+
+Runs vsopc in -lex, -parse, -check, -llvm and full modes over the
+resources/vsop/ corpus and over generated inputs of increasing size, and
+reports the median/p95 wall time, the peak RSS and the throughput (lines
+per second) of each mode.
+
+Results are stored as JSON and can be compared against a baseline:
+
+    python3 resources/bench/compile.py --output new.json --baseline old.json
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+MODES = {
+	'lex': ['-lex'],
+	'parse': ['-parse'],
+	'check': ['-check'],
+	'llvm': ['-llvm'],
+	'full': [],
+}
+
+
+def generate(path: str, lines: int):
+	"""Generate a valid VSOP program of about `lines` lines
+
+	The program is a chain of classes, each with a field and methods that
+	override the methods of the parent class and call them on a fresh
+	instance of the parent.
+	"""
+
+	methods = 4
+	per_class = 3 + methods * 9
+	classes = max(1, lines // per_class)
+
+	with open(path, 'w') as f:
+		for i in range(classes):
+			parent = 'Object' if i == 0 else f'C{i - 1}'
+
+			f.write(f'class C{i} extends {parent} {{\n')
+			f.write(f'    f{i} : int32 <- {i};\n')
+
+			for j in range(methods):
+				prev = f'z + f{i}' if i == 0 else f'(new C{i - 1}).m{j}(z, y) - f{i}'
+
+				f.write(f'    m{j}(x : int32, y : int32) : int32 {{\n')
+				f.write(f'        let z : int32 <- x * {j + 1} + y in {{\n')
+				f.write(f'            while z < {100 + j} do\n')
+				f.write(f'                z <- z + 1;\n')
+				f.write(f'            if z = y then x else {prev}\n')
+				f.write(f'        }}\n')
+				f.write(f'    }}\n')
+				f.write(f'    (* C{i}.m{j} *)\n')
+				f.write(f'\n')
+
+			f.write('}\n\n')
+
+		f.write('class Main {\n')
+		f.write('    main() : int32 {\n')
+		f.write(f'        let o : C{classes - 1} <- new C{classes - 1} in {{\n')
+		f.write('            printInt32(o.m0(1, 2));\n')
+		f.write('            print("\\n");\n')
+		f.write('            0\n')
+		f.write('        }\n')
+		f.write('    }\n')
+		f.write('}\n')
+
+
+def count(path: str) -> int:
+	with open(path, 'rb') as f:
+		return sum(1 for _ in f)
+
+
+def execute(cmd: list) -> tuple:
+	"""Execute a command, without output
+
+	Returns the wall time (s), the peak RSS (KiB) and the exit status.
+	"""
+
+	start = time.perf_counter()
+
+	proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+	_, status, usage = os.wait4(proc.pid, 0)
+
+	wall = time.perf_counter() - start
+	code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else 1
+
+	return wall, usage.ru_maxrss, code
+
+
+def percentile(values: list, p: float) -> float:
+	"""Nearest-rank percentile"""
+
+	values = sorted(values)
+	return values[max(0, math.ceil(p / 100 * len(values)) - 1)]
+
+
+def bench(vsopc: str, files: list, mode: str, repeat: int) -> dict:
+	"""Benchmark a mode over a set of files
+
+	Each repetition compiles every file once; statistics are over repetitions.
+	"""
+
+	lines = sum(count(f) for f in files)
+	walls, rss, failures = [], 0, 0
+
+	for _ in range(repeat):
+		total = 0.
+
+		for f in files:
+			flags = MODES[mode] + (['-ext'] if f.endswith('.vsopx') else [])
+			flags.append('-no-cache') # every repetition compiles (-llvm and full outputs are cached)
+
+			wall, peak, status = execute([vsopc] + flags + [f])
+
+			total += wall
+			rss = max(rss, peak)
+			failures += status != 0
+
+		walls.append(total)
+
+	median = statistics.median(walls)
+
+	return {
+		'files': len(files),
+		'lines': lines,
+		'runs': repeat,
+		'median': median,
+		'p95': percentile(walls, 95),
+		'rss': rss,
+		'lines_per_second': lines / median if median > 0 else 0.,
+		'failures': failures // repeat,
+	}
+
+
+def compare(results: dict, baseline: dict, threshold: float) -> list:
+	"""List the regressions of the median wall time beyond the threshold"""
+
+	regressions = []
+
+	for key, new in results.items():
+		old = baseline.get(key)
+
+		if old is None or old['median'] <= 0:
+			continue
+
+		ratio = new['median'] / old['median']
+
+		if ratio > 1 + threshold:
+			regressions.append((key, old['median'], new['median'], ratio))
+
+	return regressions
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Compile-time benchmark of vsopc')
+	parser.add_argument('--vsopc', default='./vsopc', help='compiler executable')
+	parser.add_argument('--corpus', default='resources/vsop', help='corpus directory')
+	parser.add_argument('--modes', default=','.join(MODES), help='comma-separated modes')
+	parser.add_argument('--sizes', default='1000,10000,50000', help='comma-separated generated input sizes (lines)')
+	parser.add_argument('--repeat', type=int, default=5, help='number of repetitions')
+	parser.add_argument('--output', default='bench-compile.json', help='JSON results file')
+	parser.add_argument('--baseline', default=None, help='JSON results to compare against')
+	parser.add_argument('--threshold', type=float, default=0.10, help='tolerated relative slowdown')
+
+	args = parser.parse_args()
+
+	vsopc = os.path.abspath(args.vsopc)
+	modes = [m for m in args.modes.split(',') if m]
+	sizes = [int(s) for s in args.sizes.split(',') if s]
+
+	for m in modes:
+		if m not in MODES:
+			parser.error(f'unknown mode {m}')
+
+	# Work on a copy, full compilations write executables next to the sources
+	workdir = tempfile.mkdtemp(prefix='vsopc-bench-')
+
+	try:
+		inputs = {}
+
+		corpus = os.path.join(workdir, 'corpus')
+		shutil.copytree(args.corpus, corpus)
+
+		inputs['corpus'] = sorted(
+			glob.glob(os.path.join(corpus, '**', '*.vsop'), recursive=True) +
+			glob.glob(os.path.join(corpus, '**', '*.vsopx'), recursive=True)
+		)
+
+		for size in sizes:
+			path = os.path.join(workdir, f'gen-{size}.vsop')
+			generate(path, size)
+			inputs[f'gen-{size}'] = [path]
+
+		results = {}
+
+		print(f'{"input":<12} {"mode":<6} {"lines":>8} {"median (s)":>11} {"p95 (s)":>9} {"RSS (KiB)":>10} {"lines/s":>12}')
+
+		for name, files in inputs.items():
+			for mode in modes:
+				r = bench(vsopc, files, mode, args.repeat)
+				results[f'{name}/{mode}'] = r
+
+				print(f'{name:<12} {mode:<6} {r["lines"]:>8} {r["median"]:>11.4f} {r["p95"]:>9.4f} {r["rss"]:>10} {r["lines_per_second"]:>12.0f}')
+	finally:
+		shutil.rmtree(workdir, ignore_errors=True)
+
+	# The baseline may be overwritten by the results
+	baseline = None
+
+	if args.baseline:
+		with open(args.baseline) as f:
+			baseline = json.load(f)['results']
+
+	with open(args.output, 'w') as f:
+		json.dump({'vsopc': vsopc, 'repeat': args.repeat, 'results': results}, f, indent=4)
+
+	if baseline is not None:
+		regressions = compare(results, baseline, args.threshold)
+
+		for key, old, new, ratio in regressions:
+			print(f'regression: {key}: {old:.4f}s -> {new:.4f}s ({(ratio - 1) * 100:+.1f}%)', file=sys.stderr)
+
+		if regressions:
+			sys.exit(1)
+
+
+if __name__ == '__main__':
+	main()
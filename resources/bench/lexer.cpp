@@ -0,0 +1,139 @@
+/**
+ * Lexer microbenchmark of vsopc
+ *
+ * Scans sources in-process with the scanner alone (no parser, no output) and
+ * reports the number of tokens per second. Without files, a token-dense
+ * program of about 100000 lines is generated.
+ *
+ *     make bench-lexer [LEXFLAGS="-repeat=20 -baseline=<tokens/s> file.vsop ..."]
+ *
+ * @note Run it on two revisions of the scanner to compare them, passing the rate of the first one as baseline.
+ */
+
+#include "vsop.tab.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* flex (reentrant scanner, see vsop.lex) */
+
+struct yy_buffer_state;
+
+int yylex(YYSTYPE*, YYLTYPE*, yyscan_t);
+int yylex_init_extra(yycontext*, yyscan_t*);
+yy_buffer_state* yy_scan_buffer(char*, size_t, yyscan_t);
+int yylex_destroy(yyscan_t);
+
+using namespace std;
+
+/// Generate a token-dense program of about n lines
+static string generate(int n) {
+	ostringstream os;
+
+	for (int i = 0; i * 8 < n; ++i) {
+		os << "class C" << i << " extends Object {\n";
+		os << "    field" << i << " : int32 <- 0x" << hex << i << dec << ";\n";
+		os << "    method(x : int32, s : string) : bool {\n";
+		os << "        let y : int32 <- x * " << i << " + field" << i << " in\n";
+		os << "            if not (y <= 42) and isnull self then y <- y - 1 else { print(\"line\\n\"); () };\n";
+		os << "        (* comment " << i << " *) true // end\n";
+		os << "    }\n";
+		os << "}\n";
+	}
+
+	return os.str();
+}
+
+/// Scan a buffer (followed by two null characters), returning the number of tokens
+static size_t scan(string& buffer, bool ext) {
+	ostringstream out, err;
+	yycontext ctx("<bench>", ext ? START_EXT_LEXER : START_LEXER, out, err);
+
+	yyscan_t scanner;
+	yylex_init_extra(&ctx, &scanner);
+	yy_scan_buffer(&buffer[0], buffer.size(), scanner);
+
+	YYSTYPE value;
+	YYLTYPE loc;
+	size_t tokens = 0;
+
+	yylex(&value, &loc, scanner); // parsing mode
+
+	while (yylex(&value, &loc, scanner) != END)
+		++tokens;
+
+	yylex_destroy(scanner);
+
+	return tokens;
+}
+
+int main(int argc, char* argv[]) {
+	int repeat = 10;
+	double baseline = 0; // tokens/s
+	bool ext = false;
+	vector<string> sources;
+
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+
+		if (arg.compare(0, 8, "-repeat=") == 0)
+			repeat = max(1, stoi(arg.substr(8)));
+		else if (arg.compare(0, 10, "-baseline=") == 0)
+			baseline = stod(arg.substr(10));
+		else if (arg == "-ext")
+			ext = true;
+		else {
+			ifstream file(arg, ios::binary);
+
+			if (not file) {
+				cerr << "bench-lexer: error: " << arg << ": No such file or directory" << endl;
+				return 1;
+			}
+
+			sources.push_back(string(istreambuf_iterator<char>(file), istreambuf_iterator<char>()));
+		}
+	}
+
+	if (sources.empty())
+		sources.push_back(generate(100000));
+
+	size_t bytes = 0;
+
+	for (string& s: sources) {
+		bytes += s.size();
+		s.append(2, '\0');
+	}
+
+	// Median over repetitions
+	vector<double> seconds;
+	size_t tokens = 0;
+
+	for (int r = 0; r < repeat; ++r) {
+		auto start = chrono::steady_clock::now();
+
+		tokens = 0;
+		for (string& s: sources)
+			tokens += scan(s, ext);
+
+		seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	}
+
+	sort(seconds.begin(), seconds.end());
+	double median = seconds[seconds.size() / 2];
+
+	cout << "tokens: " << tokens << endl;
+	cout << "bytes: " << bytes << endl;
+	cout << "median (s): " << median << endl;
+	cout << "tokens/s: " << size_t(tokens / median) << endl;
+	cout << "MB/s: " << bytes / median / 1e6 << endl;
+
+	if (baseline > 0)
+		cout << "speedup: " << tokens / median / baseline << endl;
+
+	return 0;
+}
@@ -8,12 +8,14 @@
 @stdin = external global %struct._IO_FILE*
 @stderr = external global %struct._IO_FILE*
 
+declare i8* @calloc(i64, i64)
 declare void @exit(i32)
 declare i32 @fprintf(%struct._IO_FILE*, i8*, ...)
 declare void @free(i8*)
 declare i32 @getc(%struct._IO_FILE*)
 declare i32 @isspace(i32)
 declare i8* @malloc(i64)
+declare i32 @memcmp(i8*, i8*, i64)
 declare i32 @printf(i8*, ...)
 declare i8* @realloc(i8*, i64)
 declare i64 @strlen(i8*)
@@ -21,6 +23,9 @@ declare i32 @strncmp(i8*, i8*, i64)
 declare i64 @strtoll(i8*, i8**, i32)
 declare i32 @ungetc(i32, %struct._IO_FILE*)
 
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i1)
+declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i1)
+
 ; Types for Object instances and vtable
 
 %struct.Object = type { %struct.ObjectVTable* }
@@ -32,12 +37,13 @@ declare i32 @ungetc(i32, %struct._IO_FILE*)
 @str.1 = constant [5 x i8] c"true\00"
 @str.2 = constant [6 x i8] c"false\00"
 @str.3 = constant [3 x i8] c"%d\00"
-@str.4 = constant [1 x i8] zeroinitializer
+@str.4 = constant { i64, i64, [1 x i8] } { i64 0, i64 -3750763034362895579, [1 x i8] zeroinitializer }
 @str.5 = constant [38 x i8] c"Object::inputBool: cannot read word!\0A\00"
 @str.6 = constant [49 x i8] c"Object::inputBool: `%s` is not a valid boolean!\0A\00"
 @str.7 = constant [39 x i8] c"Object::inputInt32: cannot read word!\0A\00"
 @str.8 = constant [58 x i8] c"Object::inputInt32: `%s` is not a valid integer literal!\0A\00"
 @str.9 = constant [57 x i8] c"Object::inputInt32: `%s` does not fit a 32-bit integer!\0A\00"
+@str.10 = constant [20 x i8] c"gc: out of memory!\0A\00"
 
 ; Object's shared vtable instance
 
@@ -67,13 +73,18 @@ define %struct.Object* @Object_printInt32(%struct.Object*, i32) {
 define i8* @Object_inputLine(%struct.Object*) {
   %2 = call i8* @read_until(i32 (i32)* @is_eol)
   %3 = icmp ne i8* %2, null
-  br i1 %3, label %5, label %4
+  br i1 %3, label %4, label %6
 
 4:                                                ; preds = %1
-  br label %5
+  %5 = call i8* @string_from(i8* %2)
+  call void @free(i8* %2)
+  br label %7
 
-5:                                                ; preds = %4, %1
-  %.0 = phi i8* [ %2, %1 ], [ getelementptr inbounds ([1 x i8], [1 x i8]* @str.4, i64 0, i64 0), %4 ]
+6:                                                ; preds = %1
+  br label %7
+
+7:                                                ; preds = %6, %4
+  %.0 = phi i8* [ %5, %4 ], [ getelementptr inbounds ({ i64, i64, [1 x i8] }, { i64, i64, [1 x i8] }* @str.4, i64 0, i32 2, i64 0), %6 ]
   ret i8* %.0
 }
 
@@ -246,7 +257,7 @@ define i32 @Object_inputInt32(%struct.Object*) {
 ; Object constructor and initializer
 
 define %struct.Object* @Object__new() {
-  %1 = call i8* @malloc(i64 8)
+  %1 = call i8* @bump_alloc(i64 16)
   %2 = bitcast i8* %1 to %struct.Object*
   %3 = call %struct.Object* @Object__init(%struct.Object* %2)
   ret %struct.Object* %3
@@ -374,3 +385,580 @@ define internal void @skip_while(i32 (i32)*) {
 19:                                               ; preds = %16, %14
   ret void
 }
+
+; Strings
+;
+; A string is a pointer to its characters, null-terminated such that it can be
+; given as is to C, preceded by its length and hash (64-bit FNV-1a), i.e.
+; '{ i64 length, i64 hash, [length + 1 x i8] chars }'. The literals are
+; constants of the module (see LLVMHelper::literal), the other strings are
+; copied by string_from, or by gc_string_from with -gc (the calls of the
+; runtime are redirected by LLVMHelper::link).
+
+%struct.String = type { i64, i64, [0 x i8] }
+
+; String of a C string (empty if null), bumped
+define i8* @string_from(i8* %s) {
+  %1 = call i8* @string_new(i8* %s, i1 false)
+  ret i8* %1
+}
+
+; String of a C string (empty if null), on the garbage collected heap
+define i8* @gc_string_from(i8* %s) {
+  %1 = call i8* @string_new(i8* %s, i1 true)
+  ret i8* %1
+}
+
+define internal i8* @string_new(i8* %s, i1 %collected) {
+entry:
+  %null = icmp eq i8* %s, null
+  br i1 %null, label %empty, label %scan
+
+scan:
+  %length = phi i64 [ 0, %entry ], [ %length.1, %next ]
+  %hash = phi i64 [ -3750763034362895579, %entry ], [ %hash.1, %next ]
+  %cp = getelementptr inbounds i8, i8* %s, i64 %length
+  %c = load i8, i8* %cp
+  %end = icmp eq i8 %c, 0
+  br i1 %end, label %alloc, label %next
+
+next:
+  %byte = zext i8 %c to i64
+  %mix = xor i64 %hash, %byte
+  %hash.1 = mul i64 %mix, 1099511628211
+  %length.1 = add i64 %length, 1
+  br label %scan
+
+alloc:
+  %size = add i64 %length, 17
+  br i1 %collected, label %gc, label %bump
+
+bump:                                             ; by multiples of 16 bytes
+  %size.0 = add i64 %size, 15
+  %size.1 = and i64 %size.0, -16
+  %p.bump = call i8* @bump_alloc(i64 %size.1)
+  br label %init
+
+gc:
+  %p.gc = call i8* @gc_alloc(i64 %size, i32* null)
+  br label %init
+
+init:
+  %p = phi i8* [ %p.bump, %bump ], [ %p.gc, %gc ]
+  %failed = icmp eq i8* %p, null
+  br i1 %failed, label %empty, label %copy
+
+copy:
+  %string = bitcast i8* %p to %struct.String*
+  %lengthp = getelementptr inbounds %struct.String, %struct.String* %string, i64 0, i32 0
+  store i64 %length, i64* %lengthp
+  %hashp = getelementptr inbounds %struct.String, %struct.String* %string, i64 0, i32 1
+  store i64 %hash, i64* %hashp
+  %chars = getelementptr inbounds %struct.String, %struct.String* %string, i64 0, i32 2, i64 0
+  %bytes = add i64 %length, 1
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %chars, i8* %s, i64 %bytes, i1 false)
+  ret i8* %chars
+
+empty:
+  ret i8* getelementptr inbounds ({ i64, i64, [1 x i8] }, { i64, i64, [1 x i8] }* @str.4, i64 0, i32 2, i64 0)
+}
+
+; Equality of two strings: length, then hash, then characters
+define i1 @string_equal(i8* %a, i8* %b) {
+entry:
+  %same = icmp eq i8* %a, %b
+  br i1 %same, label %true, label %length
+
+length:
+  %a.header = getelementptr inbounds i8, i8* %a, i64 -16
+  %a.string = bitcast i8* %a.header to %struct.String*
+  %b.header = getelementptr inbounds i8, i8* %b, i64 -16
+  %b.string = bitcast i8* %b.header to %struct.String*
+  %a.lengthp = getelementptr inbounds %struct.String, %struct.String* %a.string, i64 0, i32 0
+  %a.length = load i64, i64* %a.lengthp
+  %b.lengthp = getelementptr inbounds %struct.String, %struct.String* %b.string, i64 0, i32 0
+  %b.length = load i64, i64* %b.lengthp
+  %length.eq = icmp eq i64 %a.length, %b.length
+  br i1 %length.eq, label %hash, label %false
+
+hash:
+  %a.hashp = getelementptr inbounds %struct.String, %struct.String* %a.string, i64 0, i32 1
+  %a.hash = load i64, i64* %a.hashp
+  %b.hashp = getelementptr inbounds %struct.String, %struct.String* %b.string, i64 0, i32 1
+  %b.hash = load i64, i64* %b.hashp
+  %hash.eq = icmp eq i64 %a.hash, %b.hash
+  br i1 %hash.eq, label %chars, label %false
+
+chars:
+  %cmp = call i32 @memcmp(i8* %a, i8* %b, i64 %a.length)
+  %chars.eq = icmp eq i32 %cmp, 0
+  ret i1 %chars.eq
+
+true:
+  ret i1 true
+
+false:
+  ret i1 false
+}
+
+; Allocator
+;
+; Objects are bumped in regions of 1 MiB taken from malloc, such that the fast
+; path is an increment and a limit check, inlined into '<class>__new' once the
+; escape analysis is done (see escape.hpp). Larger objects are given to malloc.
+; The sizes are multiples of 16, such that objects are aligned as by malloc.
+;
+; A region is per program rather than per thread: VSOP programs have a single
+; thread, and programs run concurrently in-process (-run) have their own copy
+; of the runtime.
+
+@bump_next = internal global i8* null
+@bump_end = internal global i8* null
+
+define i8* @bump_alloc(i64 %size) noinline {
+entry:
+  %next = load i8*, i8** @bump_next
+  %end = load i8*, i8** @bump_end
+  %bumped = getelementptr i8, i8* %next, i64 %size
+  %fits = icmp ule i8* %bumped, %end
+  br i1 %fits, label %fast, label %slow
+
+fast:
+  store i8* %bumped, i8** @bump_next
+  ret i8* %next
+
+slow:
+  %p = call i8* @bump_refill(i64 %size)
+  ret i8* %p
+}
+
+define internal i8* @bump_refill(i64 %size) noinline {
+entry:
+  %large = icmp ugt i64 %size, 4096
+  br i1 %large, label %malloc, label %region
+
+malloc:
+  %p = call i8* @malloc(i64 %size)
+  ret i8* %p
+
+region:                                           ; the rest of the previous one is lost
+  %start = call i8* @malloc(i64 1048576)
+  %failed = icmp eq i8* %start, null
+  br i1 %failed, label %fail, label %init
+
+fail:
+  ret i8* null
+
+init:
+  %next = getelementptr inbounds i8, i8* %start, i64 %size
+  %end = getelementptr inbounds i8, i8* %start, i64 1048576
+  store i8* %next, i8** @bump_next
+  store i8* %end, i8** @bump_end
+  ret i8* %start
+}
+
+; Garbage collector (-gc)
+;
+; Mark-sweep collector of the blocks allocated by gc_alloc. A block is made of
+; a header followed by the object, zeroed. The header holds the pointer map of
+; the object, i.e. the number of pointer fields followed by their offsets in
+; bytes (null if none), as emitted for each class by the code generation.
+;
+; The roots are the frames of the shadow stack, pushed and popped by the
+; generated functions (see LLVMHelper::frame). The heap is the set of the
+; allocated blocks, such that other pointers (string literals, objects on the
+; stack or from malloc) are ignored. A string is found by its characters, past
+; its length and hash. Without any frame, i.e. without -gc,
+; nothing is ever collected.
+;
+; A collection is triggered once as many bytes have been allocated as survived
+; the previous one, but at least 4 MiB, such that the heap stays within twice
+; the live data and a pause is proportional to the heap.
+;
+; Blocks of up to 288 bytes (header included) are bumped, and recycled through
+; a free list per size class (multiple of 16 bytes) when collected. Larger ones
+; are given back to malloc.
+
+%struct.Frame = type { %struct.Frame*, i64, [0 x i8*] }
+%struct.Block = type { %struct.Block*, i32*, i64, i64 }
+
+@gc_frames = global %struct.Frame* null
+@gc_blocks = internal global %struct.Block* null
+@gc_table = internal global i8** null
+@gc_capacity = internal global i64 0
+@gc_count = internal global i64 0
+@gc_stack = internal global i8** null
+@gc_stack_size = internal global i64 0
+@gc_stack_capacity = internal global i64 0
+@gc_allocated = internal global i64 0
+@gc_threshold = internal global i64 4194304
+@gc_free = internal global [19 x %struct.Block*] zeroinitializer
+
+define i8* @gc_alloc(i64 %size, i32* %map) {
+entry:
+  %frames = load %struct.Frame*, %struct.Frame** @gc_frames
+  %rooted = icmp ne %struct.Frame* %frames, null
+  %allocated = load i64, i64* @gc_allocated
+  %threshold = load i64, i64* @gc_threshold
+  %due = icmp uge i64 %allocated, %threshold
+  %collect = and i1 %rooted, %due
+  br i1 %collect, label %gc, label %alloc
+
+gc:
+  call void @gc_collect()
+  br label %alloc
+
+alloc:
+  %bytes.0 = add i64 %size, 47
+  %bytes = and i64 %bytes.0, -16
+  %pooled = icmp ule i64 %bytes, 288
+  br i1 %pooled, label %pool, label %large
+
+pool:                                             ; size class
+  %class = lshr i64 %bytes, 4
+  %freep = getelementptr inbounds [19 x %struct.Block*], [19 x %struct.Block*]* @gc_free, i64 0, i64 %class
+  %free = load %struct.Block*, %struct.Block** %freep
+  %recycle = icmp ne %struct.Block* %free, null
+  br i1 %recycle, label %pop, label %bump
+
+pop:
+  %free.nextp = getelementptr inbounds %struct.Block, %struct.Block* %free, i64 0, i32 0
+  %free.next = load %struct.Block*, %struct.Block** %free.nextp
+  store %struct.Block* %free.next, %struct.Block** %freep
+  %recycled = bitcast %struct.Block* %free to i8*
+  br label %zero
+
+bump:
+  %bumped = call i8* @bump_alloc(i64 %bytes)
+  br label %zero
+
+large:
+  %malloced = call i8* @malloc(i64 %bytes)
+  br label %zero
+
+zero:
+  %mem = phi i8* [ %recycled, %pop ], [ %bumped, %bump ], [ %malloced, %large ]
+  %failed = icmp eq i8* %mem, null
+  br i1 %failed, label %fail, label %init
+
+fail:
+  ret i8* null
+
+init:
+  call void @llvm.memset.p0i8.i64(i8* %mem, i8 0, i64 %bytes, i1 false)
+  %block = bitcast i8* %mem to %struct.Block*
+  %head = load %struct.Block*, %struct.Block** @gc_blocks
+  %nextp = getelementptr inbounds %struct.Block, %struct.Block* %block, i64 0, i32 0
+  store %struct.Block* %head, %struct.Block** %nextp
+  %mapp = getelementptr inbounds %struct.Block, %struct.Block* %block, i64 0, i32 1
+  store i32* %map, i32** %mapp
+  %sizep = getelementptr inbounds %struct.Block, %struct.Block* %block, i64 0, i32 2
+  store i64 %size, i64* %sizep
+  store %struct.Block* %block, %struct.Block** @gc_blocks
+  %allocated.0 = load i64, i64* @gc_allocated
+  %allocated.1 = add i64 %allocated.0, %size
+  store i64 %allocated.1, i64* @gc_allocated
+  %payload = getelementptr inbounds %struct.Block, %struct.Block* %block, i64 1
+  %p = bitcast %struct.Block* %payload to i8*
+  %count = load i64, i64* @gc_count
+  %count.1 = add i64 %count, 1
+  store i64 %count.1, i64* @gc_count
+  %capacity = load i64, i64* @gc_capacity
+  %twice = shl i64 %count.1, 1
+  %full = icmp ugt i64 %twice, %capacity
+  br i1 %full, label %grow, label %insert
+
+grow:                                             ; the set is at most half full
+  %capacity.2 = shl i64 %capacity, 1
+  %small = icmp ult i64 %capacity.2, 1024
+  %capacity.1 = select i1 %small, i64 1024, i64 %capacity.2
+  call void @gc_rehash(i64 %capacity.1)
+  br label %end
+
+insert:
+  %i = call i64 @gc_slot(i8* %p)
+  %table = load i8**, i8*** @gc_table
+  %slot = getelementptr inbounds i8*, i8** %table, i64 %i
+  store i8* %p, i8** %slot
+  br label %end
+
+end:
+  ret i8* %p
+}
+
+define void @gc_collect() {
+entry:
+  %frame.0 = load %struct.Frame*, %struct.Frame** @gc_frames
+  br label %frames
+
+frames:                                           ; mark the roots
+  %frame = phi %struct.Frame* [ %frame.0, %entry ], [ %frame.1, %next ]
+  %bottom = icmp eq %struct.Frame* %frame, null
+  br i1 %bottom, label %trace, label %roots.0
+
+roots.0:
+  %countp = getelementptr inbounds %struct.Frame, %struct.Frame* %frame, i64 0, i32 1
+  %count = load i64, i64* %countp
+  br label %roots
+
+roots:
+  %i = phi i64 [ 0, %roots.0 ], [ %i.1, %root ]
+  %last = icmp sge i64 %i, %count
+  br i1 %last, label %next, label %root
+
+root:
+  %rootp = getelementptr inbounds %struct.Frame, %struct.Frame* %frame, i64 0, i32 2, i64 %i
+  %r = load i8*, i8** %rootp
+  call void @gc_mark(i8* %r)
+  %i.1 = add i64 %i, 1
+  br label %roots
+
+next:
+  %nextp = getelementptr inbounds %struct.Frame, %struct.Frame* %frame, i64 0, i32 0
+  %frame.1 = load %struct.Frame*, %struct.Frame** %nextp
+  br label %frames
+
+trace:                                            ; mark the fields of the marked blocks
+  %size = load i64, i64* @gc_stack_size
+  %empty = icmp eq i64 %size, 0
+  br i1 %empty, label %sweep, label %pop
+
+pop:
+  %size.1 = sub i64 %size, 1
+  store i64 %size.1, i64* @gc_stack_size
+  %stack = load i8**, i8*** @gc_stack
+  %topp = getelementptr inbounds i8*, i8** %stack, i64 %size.1
+  %p = load i8*, i8** %topp
+  %payload = bitcast i8* %p to %struct.Block*
+  %block = getelementptr inbounds %struct.Block, %struct.Block* %payload, i64 -1
+  %mapp = getelementptr inbounds %struct.Block, %struct.Block* %block, i64 0, i32 1
+  %map = load i32*, i32** %mapp
+  %leaf = icmp eq i32* %map, null
+  br i1 %leaf, label %trace, label %fields.0
+
+fields.0:
+  %n.32 = load i32, i32* %map
+  %n = sext i32 %n.32 to i64
+  br label %fields
+
+fields:
+  %j = phi i64 [ 1, %fields.0 ], [ %j.1, %field ]
+  %done = icmp sgt i64 %j, %n
+  br i1 %done, label %trace, label %field
+
+field:
+  %offsetp = getelementptr inbounds i32, i32* %map, i64 %j
+  %offset.32 = load i32, i32* %offsetp
+  %offset = sext i32 %offset.32 to i64
+  %addr = getelementptr inbounds i8, i8* %p, i64 %offset
+  %fieldp = bitcast i8* %addr to i8**
+  %q = load i8*, i8** %fieldp
+  call void @gc_mark(i8* %q)
+  %j.1 = add i64 %j, 1
+  br label %fields
+
+sweep:                                            ; free the unmarked blocks
+  %link = phi %struct.Block** [ @gc_blocks, %trace ], [ %link.1, %live ], [ %link, %recycle ], [ %link, %release ]
+  %live_size = phi i64 [ 0, %trace ], [ %live_size.1, %live ], [ %live_size, %recycle ], [ %live_size, %release ]
+  %live_count = phi i64 [ 0, %trace ], [ %live_count.1, %live ], [ %live_count, %recycle ], [ %live_count, %release ]
+  %b = load %struct.Block*, %struct.Block** %link
+  %swept = icmp eq %struct.Block* %b, null
+  br i1 %swept, label %end, label %check
+
+check:
+  %link.1 = getelementptr inbounds %struct.Block, %struct.Block* %b, i64 0, i32 0
+  %b.next = load %struct.Block*, %struct.Block** %link.1
+  %markp = getelementptr inbounds %struct.Block, %struct.Block* %b, i64 0, i32 3
+  %mark = load i64, i64* %markp
+  %marked = icmp ne i64 %mark, 0
+  br i1 %marked, label %live, label %dead
+
+live:
+  store i64 0, i64* %markp
+  %b.sizep = getelementptr inbounds %struct.Block, %struct.Block* %b, i64 0, i32 2
+  %b.size = load i64, i64* %b.sizep
+  %live_size.1 = add i64 %live_size, %b.size
+  %live_count.1 = add i64 %live_count, 1
+  br label %sweep
+
+dead:
+  store %struct.Block* %b.next, %struct.Block** %link
+  %b.sizep.1 = getelementptr inbounds %struct.Block, %struct.Block* %b, i64 0, i32 2
+  %b.size.1 = load i64, i64* %b.sizep.1
+  %b.bytes.0 = add i64 %b.size.1, 47
+  %b.bytes = and i64 %b.bytes.0, -16
+  %b.small = icmp ule i64 %b.bytes, 288
+  br i1 %b.small, label %recycle, label %release
+
+recycle:
+  %b.class = lshr i64 %b.bytes, 4
+  %b.freep = getelementptr inbounds [19 x %struct.Block*], [19 x %struct.Block*]* @gc_free, i64 0, i64 %b.class
+  %b.free = load %struct.Block*, %struct.Block** %b.freep
+  store %struct.Block* %b.free, %struct.Block** %link.1
+  store %struct.Block* %b, %struct.Block** %b.freep
+  br label %sweep
+
+release:
+  %b.mem = bitcast %struct.Block* %b to i8*
+  call void @free(i8* %b.mem)
+  br label %sweep
+
+end:
+  store i64 %live_count, i64* @gc_count
+  store i64 0, i64* @gc_allocated
+  %large = icmp ugt i64 %live_size, 4194304
+  %threshold = select i1 %large, i64 %live_size, i64 4194304
+  store i64 %threshold, i64* @gc_threshold
+  %capacity = load i64, i64* @gc_capacity
+  call void @gc_rehash(i64 %capacity)
+  ret void
+}
+
+define internal void @gc_mark(i8* %p) {
+entry:
+  %null = icmp eq i8* %p, null
+  %table = load i8**, i8*** @gc_table
+  %empty = icmp eq i8** %table, null
+  %skip = or i1 %null, %empty
+  br i1 %skip, label %end, label %lookup
+
+lookup:
+  %i = call i64 @gc_slot(i8* %p)
+  %slot = getelementptr inbounds i8*, i8** %table, i64 %i
+  %q = load i8*, i8** %slot
+  %heap = icmp eq i8* %q, %p
+  br i1 %heap, label %header, label %string
+
+string:
+  %s = getelementptr i8, i8* %p, i64 -16
+  %j = call i64 @gc_slot(i8* %s)
+  %slot.1 = getelementptr inbounds i8*, i8** %table, i64 %j
+  %r = load i8*, i8** %slot.1
+  %heap.1 = icmp eq i8* %r, %s
+  br i1 %heap.1, label %header, label %end
+
+header:
+  %start = phi i8* [ %p, %lookup ], [ %s, %string ]
+  %payload = bitcast i8* %start to %struct.Block*
+  %block = getelementptr inbounds %struct.Block, %struct.Block* %payload, i64 -1
+  %markp = getelementptr inbounds %struct.Block, %struct.Block* %block, i64 0, i32 3
+  %mark = load i64, i64* %markp
+  %marked = icmp ne i64 %mark, 0
+  br i1 %marked, label %end, label %push
+
+push:
+  store i64 1, i64* %markp
+  %size = load i64, i64* @gc_stack_size
+  %capacity = load i64, i64* @gc_stack_capacity
+  %full = icmp eq i64 %size, %capacity
+  br i1 %full, label %grow, label %store
+
+grow:
+  %capacity.2 = shl i64 %capacity, 1
+  %small = icmp ult i64 %capacity.2, 1024
+  %capacity.1 = select i1 %small, i64 1024, i64 %capacity.2
+  %old = load i8**, i8*** @gc_stack
+  %old.mem = bitcast i8** %old to i8*
+  %bytes = shl i64 %capacity.1, 3
+  %new.mem = call i8* @realloc(i8* %old.mem, i64 %bytes)
+  %failed = icmp eq i8* %new.mem, null
+  br i1 %failed, label %oom, label %grown
+
+oom:
+  call void @gc_oom()
+  unreachable
+
+grown:
+  %new = bitcast i8* %new.mem to i8**
+  store i8** %new, i8*** @gc_stack
+  store i64 %capacity.1, i64* @gc_stack_capacity
+  br label %store
+
+store:
+  %stack = load i8**, i8*** @gc_stack
+  %topp = getelementptr inbounds i8*, i8** %stack, i64 %size
+  store i8* %start, i8** %topp
+  %size.1 = add i64 %size, 1
+  store i64 %size.1, i64* @gc_stack_size
+  br label %end
+
+end:
+  ret void
+}
+
+; Slot of a block in the set, or of the empty slot where it would be inserted
+define internal i64 @gc_slot(i8* %p) {
+entry:
+  %capacity = load i64, i64* @gc_capacity
+  %mask = sub i64 %capacity, 1
+  %table = load i8**, i8*** @gc_table
+  %address = ptrtoint i8* %p to i64
+  %key = lshr i64 %address, 4
+  %hash = mul i64 %key, -7046029254386353131
+  %i.0 = and i64 %hash, %mask
+  br label %probe
+
+probe:
+  %i = phi i64 [ %i.0, %entry ], [ %i.2, %next ]
+  %slot = getelementptr inbounds i8*, i8** %table, i64 %i
+  %q = load i8*, i8** %slot
+  %empty = icmp eq i8* %q, null
+  %found = icmp eq i8* %q, %p
+  %stop = or i1 %empty, %found
+  br i1 %stop, label %end, label %next
+
+next:
+  %i.1 = add i64 %i, 1
+  %i.2 = and i64 %i.1, %mask
+  br label %probe
+
+end:
+  ret i64 %i
+}
+
+; Rebuild the set of the blocks, with a given capacity (a power of two)
+define internal void @gc_rehash(i64 %capacity) {
+entry:
+  %old = load i8**, i8*** @gc_table
+  %old.mem = bitcast i8** %old to i8*
+  call void @free(i8* %old.mem)
+  %mem = call i8* @calloc(i64 %capacity, i64 8)
+  %failed = icmp eq i8* %mem, null
+  br i1 %failed, label %oom, label %init
+
+oom:
+  call void @gc_oom()
+  unreachable
+
+init:
+  %table = bitcast i8* %mem to i8**
+  store i8** %table, i8*** @gc_table
+  store i64 %capacity, i64* @gc_capacity
+  %block.0 = load %struct.Block*, %struct.Block** @gc_blocks
+  br label %blocks
+
+blocks:
+  %block = phi %struct.Block* [ %block.0, %init ], [ %block.1, %insert ]
+  %done = icmp eq %struct.Block* %block, null
+  br i1 %done, label %end, label %insert
+
+insert:
+  %payload = getelementptr inbounds %struct.Block, %struct.Block* %block, i64 1
+  %p = bitcast %struct.Block* %payload to i8*
+  %i = call i64 @gc_slot(i8* %p)
+  %slot = getelementptr inbounds i8*, i8** %table, i64 %i
+  store i8* %p, i8** %slot
+  %nextp = getelementptr inbounds %struct.Block, %struct.Block* %block, i64 0, i32 0
+  %block.1 = load %struct.Block*, %struct.Block** %nextp
+  br label %blocks
+
+end:
+  ret void
+}
+
+define internal void @gc_oom() {
+  %1 = load %struct._IO_FILE*, %struct._IO_FILE** @stderr
+  %2 = call i32 (%struct._IO_FILE*, i8*, ...) @fprintf(%struct._IO_FILE* %1, i8* getelementptr inbounds ([20 x i8], [20 x i8]* @str.10, i64 0, i64 0))
+  call void @exit(i32 1)
+  unreachable
+}
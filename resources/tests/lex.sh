@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Lexer consistency test of vsopc
+#
+# For every source of resources/vsop/, checks that the tokens are the same
+#  - when the source is read from a pipe instead of being mapped in memory,
+#  - when the source is replayed from its binary token stream (-lex-bin).
+#
+#     make test-lex
+#     bash resources/tests/lex.sh ./vsopc
+
+vsopc=$(realpath "${1:-./vsopc}")
+
+if [ ! -x "$vsopc" ]; then
+	echo "lex.sh: ${1:-./vsopc}: no such executable" >&2
+	exit 1
+fi
+
+tmp=$(mktemp -d)
+
+trap 'rm -rf "$tmp"' EXIT
+
+sources=0
+failures=0
+
+cd "$(dirname "$0")/../vsop"
+
+fail() {
+	echo "FAIL $1: $2"
+	failures=$((failures + 1))
+}
+
+for file in $(find . -name '*.vsop' -o -name '*.vsopx' | sort); do
+	flags="-no-cache -lex"
+
+	case "$file" in
+		*.vsopx) flags="-ext $flags" ;;
+	esac
+
+	sources=$((sources + 1))
+
+	$vsopc $flags "$file" > "$tmp/mapped" 2> /dev/null
+	status=$?
+
+	# read() fallback
+	$vsopc $flags /dev/stdin < "$file" > "$tmp/piped" 2> /dev/null
+
+	if [ $? -ne $status ] || ! cmp -s "$tmp/mapped" "$tmp/piped"; then
+		fail "$file" "tokens differ when read from a pipe"
+	fi
+
+	# Binary token stream round trip
+	$vsopc ${flags/-lex/-lex-bin} "$file" > "$tmp/tokens" 2> /dev/null
+	$vsopc $flags "$tmp/tokens" > "$tmp/replayed" 2> /dev/null
+
+	if ! cmp -s "$tmp/mapped" "$tmp/replayed"; then
+		fail "$file" "tokens differ when replayed from -lex-bin"
+	fi
+done
+
+echo "$sources sources, $failures failures"
+
+[ $failures -eq 0 ]
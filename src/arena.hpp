@@ -0,0 +1,121 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Region of objects released at once
+ *
+ * Objects are constructed one after the other in large blocks and live as
+ * long as the arena. When it is destroyed, only the objects with a non-trivial
+ * destructor are destroyed, then the blocks are freed.
+ *
+ * @note An arena is not thread-safe, concurrent parses use one arena each.
+ */
+class Arena {
+	public:
+		Arena() {}
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		Arena(Arena&&) = default;
+		Arena& operator=(Arena&&) = delete;
+
+		~Arena() {
+			for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+				it->destroy(it->object);
+		}
+
+		/// Construct an object in the arena
+		template <typename T, typename... Args>
+		T* make(Args&&... args) {
+			T* t = new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+			if (not std::is_trivially_destructible<T>::value)
+				destructors.push_back({t, [](void* p) { static_cast<T*>(p)->~T(); }});
+
+			return t;
+		}
+
+		/// Number of bytes used by the objects
+		size_t size() const {
+			return total;
+		}
+
+		/// Allocate raw memory in the arena, released with it
+		void* allocate(size_t size, size_t align) {
+			size_t offset = (used + align - 1) & ~(align - 1);
+
+			if (blocks.empty() or offset + size > capacity) {
+				capacity = size > BLOCK ? size : BLOCK;
+				blocks.emplace_back(new char[capacity]);
+				offset = 0;
+			}
+
+			used = offset + size;
+			total += size;
+
+			return blocks.back().get() + offset;
+		}
+
+	private:
+		static const size_t BLOCK = 1 << 16;
+
+		std::vector<std::unique_ptr<char[]>> blocks;
+		size_t used = 0, capacity = 0, total = 0;
+
+		struct Destructor {
+			void* object;
+			void (*destroy)(void*);
+		};
+
+		std::vector<Destructor> destructors;
+};
+
+/**
+ * Allocator of a standard container in an arena
+ *
+ * Without an arena, the memory is taken from the heap, as by std::allocator.
+ *
+ * @remark The arena never gives memory back, such that a growing container leaves its previous storage unused
+ * (at most as much as it uses, the growth being geometric).
+ * @warning The arena must not be moved while the containers grow.
+ */
+template <typename T>
+class ArenaAllocator {
+	public:
+		using value_type = T;
+
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		ArenaAllocator(Arena* arena=nullptr): arena(arena) {}
+
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other): arena(other.arena) {}
+
+		T* allocate(size_t n) {
+			if (arena)
+				return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+
+			return std::allocator<T>().allocate(n);
+		}
+
+		void deallocate(T* p, size_t n) {
+			if (not arena)
+				std::allocator<T>().deallocate(p, n);
+		}
+
+		friend bool operator==(const ArenaAllocator& a, const ArenaAllocator& b) { return a.arena == b.arena; }
+		friend bool operator!=(const ArenaAllocator& a, const ArenaAllocator& b) { return a.arena != b.arena; }
+
+		Arena* arena;
+};
+
+#endif
@@ -1,7 +1,9 @@
 #include "ast.hpp"
 #include "tools.hpp"
 
-#include <iterator>
+#include "llvm/Support/TimeProfiler.h"
+
+#include <algorithm>
 
 using namespace std;
 
@@ -37,24 +39,132 @@ static void imhere(int i) {
 /***** Static functions *****/
 
 /*
- * Cast a value into a target type, if possible.
+ * Cast a value into a target type.
  *
  * @remark If the value is already of the target type, nothing is done.
+ * @warning The value type should conform to the target type (see VType::conformsTo).
+ */
+static llvm::Value* castToTargetTy(LLVMHelper& h, llvm::Value* value, const VType& value_t, const VType& target_t) {
+	if (value_t == target_t)
+		return value;
+	else if (value_t.isNumeric() and target_t.isNumeric())
+		return h.numericCast(value, target_t.getType(h));
+
+	return h.builder->CreatePointerCast(value, target_t.getType(h));
+}
+
+/*
+ * Count an access to a field, if instrumented.
+ *
+ * @see Program::instrument
  */
-static llvm::Value* castToTargetTy(Program& p, LLVMHelper& h, llvm::Value* value, llvm::Type* target_t) {
-	if (not value)
+static void count(LLVMHelper& h, Field* field) {
+	if (h.instrument.empty())
+		return;
+
+	llvm::Type* counter_t = llvm::Type::getInt64Ty(*h.context);
+	llvm::Value* counter = h.module->getOrInsertGlobal("counter." + field->parent->name + "." + field->name, counter_t);
+
+	h.builder->CreateStore(
+		h.builder->CreateAdd(h.builder->CreateLoad(counter_t, counter), llvm::ConstantInt::get(counter_t, 1)),
+		counter
+	);
+}
+
+/*
+ * Call a method on an object, given the static class of the object.
+ *
+ * @remark If the method has a single implementation among the class and its subclasses, the call is direct. If it has two or three, the vtable entry is compared to each of them and guards direct calls. Otherwise, the call goes through the vtable.
+ * @note The receiver is the first parameter.
+ */
+static llvm::Value* dispatch(Program& p, LLVMHelper& h, Class* c, Method* m, vector<llvm::Value*>& params) {
+	llvm::Value* obj = params.front();
+
+	vector<Method*> impls;
+
+	if (h.speed_level or h.size_level) // not at -O0
+		impls = p.implementations(c, m->name);
+
+	if (impls.size() == 1) {
+		params.front() = h.builder->CreatePointerCast(obj, impls.front()->parent->getType(h)->getPointerTo());
+		return h.builder->CreateCall(impls.front()->getFunction(h), params);
+	}
+
+	llvm::Value* f = h.builder->CreateLoad(
+		h.builder->CreateStructGEP(
+			h.builder->CreateLoad(
+				h.builder->CreateStructGEP(obj, 0)
+			), // obj->vtable
+			m->idx
+		) // vtable->method
+	); // vtable->method
+
+	if (impls.size() < 2 or impls.size() > 3)
+		return h.builder->CreateCall(
+			llvm::cast<llvm::FunctionType>(f->getType()->getPointerElementType()),
+			f,
+			params
+		);
+
+	// Guarded direct calls
+	llvm::Function* current = h.builder->GetInsertBlock()->getParent();
+	llvm::BasicBlock* end_block = llvm::BasicBlock::Create(*h.context, "end", current);
+
+	vector<pair<llvm::Value*, llvm::BasicBlock*>> incoming;
+
+	for (size_t i = 0; i < impls.size(); ++i) {
+		llvm::Function* g = impls[i]->getFunction(h);
+		llvm::BasicBlock* call_block = llvm::BasicBlock::Create(*h.context, "direct", current);
+		llvm::BasicBlock* next_block = nullptr;
+
+		if (i + 1 < impls.size()) {
+			next_block = llvm::BasicBlock::Create(*h.context, "guard", current);
+
+			h.builder->CreateCondBr(
+				h.builder->CreateICmpEQ(f, h.builder->CreatePointerCast(g, f->getType())),
+				call_block,
+				next_block
+			);
+		} else // implementations are exhaustive
+			h.builder->CreateBr(call_block);
+
+		h.builder->SetInsertPoint(call_block);
+
+		params.front() = h.builder->CreatePointerCast(obj, impls[i]->parent->getType(h)->getPointerTo());
+		incoming.push_back({h.builder->CreateCall(g, params), call_block});
+
+		h.builder->CreateBr(end_block);
+
+		if (next_block)
+			h.builder->SetInsertPoint(next_block);
+	}
+
+	h.builder->SetInsertPoint(end_block);
+
+	llvm::Type* return_t = incoming.front().first->getType();
+
+	if (isUnit(return_t))
 		return nullptr;
 
-	llvm::Type* value_t = value->getType();
+	auto* phi = h.builder->CreatePHI(return_t, incoming.size());
 
-	if (isSameAs(value_t, target_t))
-		return value;
-	else if (isNumeric(value_t) and isNumeric(target_t))
-		return h.numericCast(value, target_t);
-	else if (p.isSubclassOf(asString(value_t), asString(target_t)))
-		return h.builder->CreatePointerCast(value, target_t);
+	for (auto& it: incoming)
+		phi->addIncoming(it.first, it.second);
 
-	return nullptr;
+	return phi;
+}
+
+/***** Types *****/
+
+llvm::Type* VType::getType(LLVMHelper& h) const {
+	switch (kind) {
+		case INT32: return llvm::Type::getInt32Ty(*h.context);
+		case DOUBLE: return llvm::Type::getDoubleTy(*h.context);
+		case BOOL: return llvm::Type::getInt1Ty(*h.context);
+		case STRING: return llvm::Type::getInt8PtrTy(*h.context);
+		case CLASS: return c->getType(h)->getPointerTo();
+		default: return llvm::Type::getVoidTy(*h.context);
+	}
 }
 
 /***** Block *****/
@@ -80,23 +190,12 @@ string Field::toString(bool with_t) const {
 }
 
 llvm::Value* Field::_codegen(Program& p, LLVMHelper& h) {
-	llvm::Type* field_t = h.asType(type);
-
 	if (init) {
 		init->codegen(p, h);
-
-		if (isUnit(init->getType()) and isUnit(field_t))
-			return nullptr;
-
-		llvm::Value* casted = castToTargetTy(p, h, init->getValue(), field_t);
-
-		if (casted)
-			return casted;
-		else
-			h.errors.push_back({init->pos, "expected type '" + type + "', but got initializer of type '" + asString(init->getType()) + "'"});
+		return castToTargetTy(h, init->getValue(), init->getType(), resolved);
 	}
 
-	return h.defaultValue(field_t);
+	return h.defaultValue(resolved.getType(h));
 }
 
 /***** Formal *****/
@@ -121,6 +220,8 @@ void Method::codegen(Program& p, LLVMHelper& h) {
 	if (not block) // extern method
 		return;
 
+	llvm::TimeTraceScope scope("Method", name.str()); // -trace
+
 	llvm::Function* f = this->getFunction(h);
 
 	llvm::BasicBlock* entry_block = llvm::BasicBlock::Create(*h.context, "", f);
@@ -132,14 +233,14 @@ void Method::codegen(Program& p, LLVMHelper& h) {
 	/* There is no need to allocate and store 'self' because, since
 	   no one can assign to 'self', it is always in SSA form. */
 	if (parent) {
-		h.push("self", it);
+		h.push(symbols::self, it);
 		++it;
 	}
 
-	for (shared_ptr<Formal>& formal: formals)
-		if (not isUnit(formal->getType(h))) {
-			h.alloc(it->getName(), it->getType());
-			h.store(it->getName(), it);
+	for (Formal* formal: formals)
+		if (not formal->resolved.isUnit()) {
+			h.alloc(formal->name, it->getType());
+			h.store(formal->name, it);
 			++it;
 		} else
 			h.push(formal->name, nullptr);
@@ -149,79 +250,59 @@ void Method::codegen(Program& p, LLVMHelper& h) {
 
 	// Remove arguments from scope
 	if (parent)
-		h.pop("self");
+		h.pop(symbols::self);
 
-	for (shared_ptr<Formal>& formal: formals)
+	for (Formal* formal: formals)
 		h.pop(formal->name);
 
 	// Result casting
-	llvm::Type* return_t = f->getReturnType();
-
-	llvm::Value* casted = nullptr;
+	if (resolved.isUnit())
+		h.builder->CreateRetVoid();
+	else
+		h.builder->CreateRet(castToTargetTy(h, block->getValue(), block->getType(), resolved));
 
-	if (isUnit(block->getType()) and isUnit(return_t));
-	else {
-		casted = castToTargetTy(p, h, block->getValue(), return_t);
-
-		if (not casted) {
-			h.errors.push_back({block->pos, "expected type '" + type + "', but got return value of type '" + asString(block->getType()) + "'"});
-			casted = h.defaultValue(return_t);
-		}
-	}
-
-	h.builder->CreateRet(casted);
+	h.frame(f);
 }
 
-void Method::declaration(LLVMHelper& h) {
-	// Formals
-	for (auto it = formals.begin(); it != formals.end(); ++it) {
-		llvm::Type* t = (*it)->getType(h);
-
-		if (not t) { // invalid type
-			h.errors.push_back({(*it)->pos, "unknown type '" + (*it)->type  + "' for formal " + (*it)->name});
-			it = prev(formals.erase(it));
-		} else if (formals_table.find((*it)->name) != formals_table.end()) { // formal already exists
-			h.errors.push_back({(*it)->pos, "redefinition of formal " + (*it)->name + " of method " + this->getName(true)});
-			it = prev(formals.erase(it));
-		} else
-			formals_table[(*it)->name] = *it;
-	}
+void Method::declare(LLVMHelper& h) {
+	if (this->getFunction(h))
+		return;
 
 	// Return type
-	llvm::Type* return_t = h.asType(type);
+	llvm::Type* return_t = resolved.getType(h);
+
+	// Parameters
+	vector<llvm::Type*> params_t;
+
+	if (parent)
+		params_t.push_back((llvm::Type*) parent->getType(h)->getPointerTo());
 
-	if (return_t) {
-		// Parameters
-		vector<llvm::Type*> params_t;
+	for (Formal* formal: formals)
+		if (not formal->resolved.isUnit())
+			params_t.push_back(formal->getType(h));
 
-		if (parent)
-			params_t.push_back((llvm::Type*) parent->getType(h)->getPointerTo());
+	// Prototype
+	llvm::FunctionType* ft = llvm::FunctionType::get(return_t, params_t, variadic);
 
-		for (shared_ptr<Formal>& formal: formals)
-			if (not isUnit(formal->getType(h)))
-				params_t.push_back(formal->getType(h));
+	// Forward declaration
+	llvm::Function* f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, this->getName(), *h.module);
 
-		// Prototype
-		llvm::FunctionType* ft = llvm::FunctionType::get(return_t, params_t, variadic);
+	if (parent)
+		h.owner(f, parent->name);
 
-		// Forward declaration
-		llvm::Function* f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, this->getName(), *h.module);
+	// Set arguments names
+	auto it = f->arg_begin();
 
-		// Set arguments names
-		auto it = f->arg_begin();
+	if (parent) {
+		it->setName("self");
+		++it;
+	}
 
-		if (parent) {
-			it->setName("self");
+	for (Formal* formal: formals)
+		if (not formal->resolved.isUnit()) {
+			it->setName(formal->name.str());
 			++it;
 		}
-
-		for (shared_ptr<Formal>& formal: formals)
-			if (not isUnit(formal->getType(h))) {
-				it->setName(formal->name);
-				++it;
-			}
-	} else
-		h.errors.push_back({this->pos, "unknown return type '" + type + "' of method " + this->getName(true)});
 }
 
 /***** Class *****/
@@ -231,6 +312,8 @@ string Class::toString(bool with_t) const {
 }
 
 void Class::codegen(Program& p, LLVMHelper& h) {
+	llvm::TimeTraceScope scope("Class", name.str()); // -trace
+
 	// Init
 	llvm::Function* f = h.module->getFunction(name + "__init");
 
@@ -248,21 +331,23 @@ void Class::codegen(Program& p, LLVMHelper& h) {
 		);
 
 	// Initialize the fields
-	for (shared_ptr<Field>& field: fields) {
+	for (Field* field: fields) {
 		field->codegen(p, h);
 
-		if (not isUnit(field->getType()))
+		if (not field->resolved.isUnit())
 			h.builder->CreateStore(
 				field->getValue(),
 				h.builder->CreateStructGEP(
 					f->arg_begin(),
-					fields_table[field->name]->idx
+					field->idx
 				)
 			);
 	}
 
 	h.builder->CreateRetVoid();
 
+	h.frame(f);
+
 	// New
 	f = h.module->getFunction(name + "__new");
 
@@ -274,17 +359,32 @@ void Class::codegen(Program& p, LLVMHelper& h) {
 
 	// Allocation of heap memory
 	size_t alloc_size = h.module->getDataLayout().getTypeAllocSize(this->getType(h));
-	llvm::Value* memory = h.builder->CreateCall(
-		h.module->getOrInsertFunction(
-			"malloc",
-			llvm::FunctionType::get(
-				llvm::Type::getInt8PtrTy(*h.context),
-				{llvm::Type::getInt64Ty(*h.context)},
-				false
-			)
-		),
-		{llvm::ConstantInt::get(llvm::Type::getInt64Ty(*h.context), alloc_size)}
-	);
+	llvm::Value* memory;
+
+	if (h.gc)
+		memory = h.builder->CreateCall(
+			h.module->getOrInsertFunction(
+				"gc_alloc",
+				llvm::FunctionType::get(
+					llvm::Type::getInt8PtrTy(*h.context),
+					{llvm::Type::getInt64Ty(*h.context), llvm::Type::getInt32PtrTy(*h.context)},
+					false
+				)
+			),
+			{llvm::ConstantInt::get(llvm::Type::getInt64Ty(*h.context), alloc_size), this->pointers(h)}
+		);
+	else // bump allocator of the runtime, by multiples of 16 bytes
+		memory = h.builder->CreateCall(
+			h.module->getOrInsertFunction(
+				"bump_alloc",
+				llvm::FunctionType::get(
+					llvm::Type::getInt8PtrTy(*h.context),
+					{llvm::Type::getInt64Ty(*h.context)},
+					false
+				)
+			),
+			{llvm::ConstantInt::get(llvm::Type::getInt64Ty(*h.context), (alloc_size + 15) / 16 * 16)}
+		);
 
 	// Conditional branching
 	h.builder->CreateCondBr(
@@ -296,10 +396,10 @@ void Class::codegen(Program& p, LLVMHelper& h) {
 	// Initialization block
 	h.builder->SetInsertPoint(init_block);
 
-	llvm::Value* instance = h.builder->CreateBitCast(
+	llvm::Value* instance = h.retain(h.builder->CreateBitCast(
 		memory,
 		this->getType(h)->getPointerTo()
-	);
+	)); // while initialized
 
 	h.builder->CreateCall(
 		h.module->getFunction(name + "__init"),
@@ -319,88 +419,22 @@ void Class::codegen(Program& p, LLVMHelper& h) {
 		llvm::ConstantPointerNull::get(this->getType(h)->getPointerTo())
 	);
 
+	h.frame(f);
+
 	// Methods code generation
 	methods.codegen(p, h);
 }
 
-void Class::declaration(LLVMHelper& h) {
-	// Ensure parent is declared
-	if (parent and not parent->isDeclared(h))
-		parent->declaration(h);
-
-	// Indices
-	unsigned f_idx = 1, m_idx = 0;
-
-	if (parent) {
-		for (auto& it: parent->fields_table)
-			f_idx = max(f_idx, it.second->idx + 1);
-		for (auto& it: parent->methods_table)
-			m_idx = max(m_idx, it.second->idx + 1);
-	}
-
-	// Fields
-	for (auto it = fields.begin(); it != fields.end(); ++it) {
-		llvm::Type* t = h.asType((*it)->type);
-
-		if (not t) { // invalid type
-			h.errors.push_back({this->pos, "unknown type '" + (*it)->type + "' for field " + (*it)->name});
-			it = prev(fields.erase(it));
-		} else if (fields_table.find((*it)->name) != fields_table.end()) { // field already exists
-			h.errors.push_back({(*it)->pos, "redefinition of field " + (*it)->name + " of class " + name});
-			it = prev(fields.erase(it));
-		} else if (parent and parent->fields_table.find((*it)->name) != parent->fields_table.end()) { // field already exists in parent
-			h.errors.push_back({(*it)->pos, "overriding field " + (*it)->name + " of class " + name});
-			it = prev(fields.erase(it));
-		} else {
-			fields_table[(*it)->name] = *it;
-			(*it)->idx = isUnit(t) ? f_idx : f_idx++;
-		}
-	}
+void Class::declare(LLVMHelper& h) {
+	if (this->isDeclared(h))
+		return;
 
+	// Ensure parent and methods are declared
 	if (parent)
-		fields_table.insert(parent->fields_table.begin(), parent->fields_table.end());
-
-	// Methods
-	for (auto it = methods.begin(); it != methods.end(); ++it) {
-		(*it)->parent = this;
-
-		if (methods_table.find((*it)->name) != methods_table.end()) { // method already exists
-			h.errors.push_back({(*it)->pos, "redefinition of method " + (*it)->getName(true)});
-			it = prev(methods.erase(it));
-		} else {
-			(*it)->declaration(h);
-			llvm::Function* f = (*it)->getFunction(h);
-
-			if (not f) // invalid function
-				it = prev(methods.erase(it));
-			else if (parent and parent->methods_table.find((*it)->name) != parent->methods_table.end()) { // method already exists in parent
-				shared_ptr<Method> m = parent->methods_table[(*it)->name];
-
-				int i = 0;
-				if ((*it)->formals.size() == m->formals.size())
-					for (; i < (*it)->formals.size(); ++i)
-						if ((*it)->formals[i]->type != m->formals[i]->type)
-							break;
-
-				if ((*it)->type == m->type and i == (*it)->formals.size()) {
-					methods_table[(*it)->name] = *it;
-					(*it)->idx = m->idx;
-				} else {
-					h.errors.push_back({(*it)->pos, "overriding method " + m->getName(true) + " with different signature"});
-					f->eraseFromParent();
-					it = prev(methods.erase(it));
-				}
-			} else {
-				methods_table[(*it)->name] = *it;
-				(*it)->idx = m_idx++;
-			}
-		}
-	}
+		parent->declare(h);
 
-	if (parent)
-		for (auto it = parent->methods_table.begin(); it != parent->methods_table.end(); ++it)
-			if (methods_table.find(it->first) == methods_table.end())
-				methods_table[it->first] = it->second;
+	for (Method* m: methods)
+		m->declare(h);
 
 	// Initialize struct and vtable types
 	llvm::StructType* self_t = this->getType(h);
@@ -412,15 +446,13 @@ void Class::declaration(LLVMHelper& h) {
 	elements_t.push_back(vtable_t->getPointerTo()); // vtable slot
 
 	for (auto it: fields_table) {
-		llvm::Type* t = h.asType(it.second->type);
-
-		if (isUnit(t))
+		if (it.second->resolved.isUnit())
 			continue;
 
 		if (it.second->idx >= elements_t.size())
 			elements_t.resize(it.second->idx + 1);
 
-		elements_t[it.second->idx] = t;
+		elements_t[it.second->idx] = it.second->resolved.getType(h);
 	}
 
 	self_t->setBody(elements_t);
@@ -463,10 +495,12 @@ void Class::declaration(LLVMHelper& h) {
 		), // Initializer
 		"vtable." + name // Name
 	);
+	h.owner(vtable, name);
 
 	// New
 	llvm::FunctionType* ft = llvm::FunctionType::get(self_t->getPointerTo(), false);
 	llvm::Function* f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name + "__new", *h.module);
+	h.owner(f, name);
 
 	// Init
 	ft = llvm::FunctionType::get(
@@ -476,6 +510,41 @@ void Class::declaration(LLVMHelper& h) {
 	);
 	f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name + "__init", *h.module);
 	f->arg_begin()->setName("self");
+	h.owner(f, name);
+}
+
+llvm::Constant* Class::pointers(LLVMHelper& h) {
+	llvm::Type* offset_t = llvm::Type::getInt32Ty(*h.context);
+	const llvm::StructLayout* layout = h.module->getDataLayout().getStructLayout(this->getType(h));
+
+	vector<uint64_t> offsets;
+
+	for (auto& it: fields_table)
+		if (it.second->resolved.kind == VType::CLASS or it.second->resolved.kind == VType::STRING)
+			offsets.push_back(layout->getElementOffset(it.second->idx));
+
+	if (offsets.empty())
+		return llvm::ConstantPointerNull::get(offset_t->getPointerTo());
+
+	sort(offsets.begin(), offsets.end());
+
+	vector<llvm::Constant*> map = {llvm::ConstantInt::get(offset_t, offsets.size())};
+
+	for (uint64_t offset: offsets)
+		map.push_back(llvm::ConstantInt::get(offset_t, offset));
+
+	llvm::ArrayType* map_t = llvm::ArrayType::get(offset_t, map.size());
+	llvm::GlobalVariable* gv = new llvm::GlobalVariable(
+		*h.module,
+		map_t,
+		true,
+		llvm::GlobalValue::PrivateLinkage,
+		llvm::ConstantArray::get(map_t, map),
+		"gcmap." + name.str()
+	);
+	h.owner(gv, name);
+
+	return llvm::ConstantExpr::getPointerCast(gv, offset_t->getPointerTo());
 }
 
 /***** Program *****/
@@ -495,97 +564,117 @@ void Program::codegen(Program& p, LLVMHelper& h) {
 	functions.codegen(p, h);
 
 	// Main
-	if (functions_table.find("main") != functions_table.end()) {
-		shared_ptr<Method> m = functions_table["main"];
+	this->entry(p, h);
+}
 
-		if (m->formals.size() != 0 or m->type != "int32")
-			h.errors.push_back({m->pos, "function " + m->getName(true) + " declared with wrong signature"});
-	} else if (classes_table.find("Main") != classes_table.end()) {
-		shared_ptr<Class> c = classes_table["Main"];
+void Program::entry(Program& p, LLVMHelper& h) {
+	if (not main) // 'main' function, or invalid entry point
+		return;
 
-		if (c->methods_table.find("main") != c->methods_table.end()) {
-			shared_ptr<Method> m = c->methods_table["main"];
+	llvm::FunctionType* ft = llvm::FunctionType::get(
+		llvm::Type::getInt32Ty(*h.context), {}, false
+	);
+	llvm::Function* f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, "main", *h.module);
 
-			if (m->formals.size() == 0 and m->type == "int32") { // main() : int32
-				llvm::FunctionType* ft = llvm::FunctionType::get(
-					h.asType("int32"), {}, false
-				);
-				llvm::Function* f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, "main", *h.module);
+	// { (new Main).main() }
+	llvm::BasicBlock* entry_block = llvm::BasicBlock::Create(*h.context, "", f);
+	h.builder->SetInsertPoint(entry_block);
 
-				// { (new Main).main() }
-				llvm::BasicBlock* entry_block = llvm::BasicBlock::Create(*h.context, "", f);
-				h.builder->SetInsertPoint(entry_block);
+	llvm::Value* status = main->_codegen(p, h);
 
-				h.builder->CreateRet(
-					Call(
-						new New("Main"), "main", {}
-					)._codegen(p, h)
-				);
-			} else
-				h.errors.push_back({m->pos, "method " + m->getName(true) + " declared with wrong signature"});
-		} else
-			h.errors.push_back({c->pos, "undeclared method main in class Main"});
-	} else
-		h.errors.push_back({this->pos, "undeclared class Main"});
+	if (not h.instrument.empty())
+		this->instrument(h);
+
+	h.builder->CreateRet(status);
+
+	h.frame(f);
 }
 
-void Program::declaration(LLVMHelper& h) {
-	// Object
-	classes_table["Object"] = shared_ptr<Class>(new Class("Object", "Object", {},
-		List<Method>({
-			new Method("print", {new Formal("s", "string")}, "Object", nullptr),
-			new Method("printBool", {new Formal("b", "bool")}, "Object", nullptr),
-			new Method("printInt32", {new Formal("i", "int32")}, "Object", nullptr),
-			new Method("inputLine", {}, "string", nullptr),
-			new Method("inputBool", {}, "bool", nullptr),
-			new Method("inputInt32", {}, "int32", nullptr)
-		})
-	));
-
-	classes_table["Object"]->getType(h); // class forward declaration
-
-	// Classes redefinition and overriding
-	int size;
-	do {
-		size = classes_table.size();
-
-		for (auto it = classes.begin(); it != classes.end(); ++it)
-			if ((*it)->parent) // class has already been processed
+void Program::instrument(LLVMHelper& h) {
+	llvm::Type* counter_t = llvm::Type::getInt64Ty(*h.context);
+	llvm::Type* ptr_t = llvm::Type::getInt8PtrTy(*h.context);
+
+	auto fopen = h.module->getOrInsertFunction("fopen", llvm::FunctionType::get(ptr_t, {ptr_t, ptr_t}, false));
+	auto fprintf = h.module->getOrInsertFunction("fprintf", llvm::FunctionType::get(h.builder->getInt32Ty(), {ptr_t, ptr_t}, true));
+	auto fclose = h.module->getOrInsertFunction("fclose", llvm::FunctionType::get(h.builder->getInt32Ty(), {ptr_t}, false));
+
+	// Appended, such that several runs add up
+	llvm::Value* file = h.builder->CreateCall(fopen, {
+		h.builder->CreateGlobalStringPtr(h.instrument),
+		h.builder->CreateGlobalStringPtr("a")
+	});
+
+	llvm::Function* current = h.builder->GetInsertBlock()->getParent();
+	llvm::BasicBlock* dump_block = llvm::BasicBlock::Create(*h.context, "dump", current);
+	llvm::BasicBlock* end_block = llvm::BasicBlock::Create(*h.context, "end", current);
+
+	h.builder->CreateCondBr(h.builder->CreateIsNull(file), end_block, dump_block);
+	h.builder->SetInsertPoint(dump_block);
+
+	for (Class* c: classes)
+		for (Field* field: c->fields) {
+			if (field->resolved.isUnit())
 				continue;
-			else if (classes_table.find((*it)->name) != classes_table.end()) { // class already exists
-				h.errors.push_back({(*it)->pos, "redefinition of class " + (*it)->name});
-				it = classes.erase(it);
-			} else if (classes_table.find((*it)->parent_name) != classes_table.end()) { // class parent exists
-				classes_table[(*it)->name] = *it;
-				(*it)->parent = classes_table[(*it)->parent_name].get();
-				(*it)->getType(h); // class forward declaration
-			}
-
-	} while (size < classes_table.size());
-
-	for (auto it = classes.begin(); it != classes.end(); ++it)
-		if ((*it)->parent) // class has been processed
-			(*it)->declaration(h);
-		else {
-			h.errors.push_back({(*it)->pos, "class " + (*it)->name + " cannot extend class " + (*it)->parent_name});
-			it = prev(classes.erase(it));
+
+			// Defined here, declared by the other modules
+			auto* counter = llvm::cast<llvm::GlobalVariable>(
+				h.module->getOrInsertGlobal("counter." + c->name + "." + field->name, counter_t)
+			);
+			counter->setInitializer(llvm::ConstantInt::get(counter_t, 0));
+
+			h.builder->CreateCall(fprintf, {
+				file,
+				h.builder->CreateGlobalStringPtr(c->name + " " + field->name + " %llu\n"),
+				h.builder->CreateLoad(counter_t, counter)
+			});
 		}
 
-	// Functions redefinition
-	for (auto it = functions.begin(); it != functions.end(); ++it) {
-		(*it)->declaration(h);
+	h.builder->CreateCall(fclose, {file});
+	h.builder->CreateBr(end_block);
 
-		llvm::Function* f = (*it)->getFunction(h);
+	h.builder->SetInsertPoint(end_block);
+}
 
-		if (not f) // invalid function
-			it = prev(functions.erase(it));
-		else if (functions_table.find((*it)->name) != functions_table.end()) { // function already exists
-			h.errors.push_back({(*it)->pos, "redefinition of function " + (*it)->getName(true)});
-			f->eraseFromParent();
-			it = prev(functions.erase(it));
-		} else
-			functions_table[(*it)->name] = *it;
-	}
+void Program::declare(LLVMHelper& h) {
+	// Classes forward declaration
+	for (auto& it: classes_table)
+		it.second->getType(h);
+
+	// Classes
+	for (Class* c: classes)
+		c->declare(h);
+
+	// Functions
+	for (Method* f: functions)
+		f->declare(h);
+}
+
+const vector<Method*>& Program::implementations(Class* c, Symbol name) {
+	lock_guard<mutex> lock(implementations_mutex);
+
+	uint64_t key = (uint64_t(c->name.getId()) << 32) | name.getId();
+
+	auto it = implementations_table.find(key);
+	if (it != implementations_table.end())
+		return it->second;
+
+	vector<Method*>& methods = implementations_table[key];
+
+	// Object, then classes in declaration order
+	vector<Class*> subclasses = {classes_table[symbols::Object]};
+
+	for (Class* d: classes)
+		subclasses.push_back(d);
+
+	for (Class* d: subclasses)
+		if (Class::isSubclassOf(d, c)) {
+			auto jt = d->methods_table.find(name);
+
+			if (jt != d->methods_table.end() and find(methods.begin(), methods.end(), jt->second) == methods.end())
+				methods.push_back(jt->second);
+		}
+
+	return methods;
 }
 
 /***** If *****/
@@ -599,10 +688,6 @@ string If::_toString(bool with_t) const {
 
 llvm::Value* If::_codegen(Program& p, LLVMHelper& h) {
 	cond->codegen(p, h);
-	llvm::Type* cond_t = cond->getType();
-
-	if (not isBoolean(cond_t))
-		h.errors.push_back({cond->pos, "expected type 'bool', but got condition of type '" + asString(cond_t) + "'"});
 
 	llvm::Function* f = h.builder->GetInsertBlock()->getParent();
 
@@ -612,11 +697,7 @@ llvm::Value* If::_codegen(Program& p, LLVMHelper& h) {
 	llvm::BasicBlock* end_block = llvm::BasicBlock::Create(*h.context, "end", f);
 
 	// Conditional branching
-	h.builder->CreateCondBr(
-		isBoolean(cond_t) ? cond->getValue() : llvm::ConstantInt::getFalse(*h.context),
-		then_block,
-		else_block
-	);
+	h.builder->CreateCondBr(cond->getValue(), then_block, else_block);
 
 	// Then block
 	h.builder->SetInsertPoint(then_block);
@@ -629,40 +710,27 @@ llvm::Value* If::_codegen(Program& p, LLVMHelper& h) {
 		els->codegen(p, h);
 	llvm::BasicBlock* else_bis = h.builder->GetInsertBlock();
 
-	// Return type
+	// Casting to the return type
 	llvm::Value* then_val = then->getValue();
 	llvm::Value* else_val = els ? els->getValue() : nullptr;
 
-	llvm::Type* then_t = then_val ? then_val->getType() : nullptr;
-	llvm::Type* else_t = else_val ? else_val->getType() : nullptr;
-	llvm::Type* end_t = nullptr;
-
-	if (isSameAs(then_t, else_t))
-		end_t = then_t;
-	else if (isNumeric(then_t) and isNumeric(else_t))
-		end_t = h.asType("double");
-	else if (isClass(then_t) and isClass(else_t))
-		end_t = p.commonAncestor(asString(then_t), asString(else_t))->getType(h)->getPointerTo();
-	else if (not isUnit(then_t) and not isUnit(else_t))
-		h.errors.push_back({this->pos, "expected agreeing branch types, but got types '" + asString(then_t) + "' and '" + asString(else_t) + "'"});
-
 	// Then block
 	h.builder->SetInsertPoint(then_bis);
-	if (not isUnit(end_t) and not isSameAs(then_t, end_t))
-		then_val = castToTargetTy(p, h, then_val, end_t);
+	if (not _type.isUnit())
+		then_val = castToTargetTy(h, then_val, then->getType(), _type);
 	h.builder->CreateBr(end_block);
 
 	// Else block
 	h.builder->SetInsertPoint(else_bis);
-	if (not isUnit(end_t) and not isSameAs(else_t, end_t))
-		else_val = castToTargetTy(p, h, else_val, end_t);
+	if (not _type.isUnit())
+		else_val = castToTargetTy(h, else_val, els->getType(), _type);
 	h.builder->CreateBr(end_block);
 
-	// End block
+		// End block
 	h.builder->SetInsertPoint(end_block);
 
-	if (not isUnit(end_t)) {
-		auto* phi = h.builder->CreatePHI(end_t, 2);
+	if (not _type.isUnit()) {
+		auto* phi = h.builder->CreatePHI(_type.getType(h), 2);
 		phi->addIncoming(then_val, then_bis);
 		phi->addIncoming(else_val, else_bis);
 
@@ -695,17 +763,9 @@ llvm::Value* While::_codegen(Program& p, LLVMHelper& h) {
 	h.builder->SetInsertPoint(cond_block);
 
 	cond->codegen(p, h);
-	llvm::Type* cond_t = cond->getType();
-
-	if (not isBoolean(cond_t))
-		h.errors.push_back({cond->pos, "expected type 'bool', but got condition of type '" + asString(cond_t) + "'"});
 
 	// Conditional branching
-	h.builder->CreateCondBr(
-		isBoolean(cond_t) ? cond->getValue() : llvm::ConstantInt::getFalse(*h.context),
-		body_block,
-		exit_block
-	);
+	h.builder->CreateCondBr(cond->getValue(), body_block, exit_block);
 
 	// Body block
 	h.builder->SetInsertPoint(body_block);
@@ -726,16 +786,13 @@ llvm::Value* While::_codegen(Program& p, LLVMHelper& h) {
 /***** Break *****/
 
 llvm::Value* Break::_codegen(Program& p, LLVMHelper& h) {
-	if (not h.exits.empty()) {
-		// Jump to exit branch
-		h.builder->CreateBr(h.exits.back());
+	// Jump to exit branch
+	h.builder->CreateBr(h.exits.back());
 
-		// Dump all following instructions in unreachable block
-		h.builder->SetInsertPoint(
-			llvm::BasicBlock::Create(*h.context, "unreachable", h.exits.back()->getParent())
-		);
-	} else
-		h.errors.push_back({this->pos, "'break' instruction not in loop"});
+	// Dump all following instructions in unreachable block
+	h.builder->SetInsertPoint(
+		llvm::BasicBlock::Create(*h.context, "unreachable", h.exits.back()->getParent())
+	);
 
 	return nullptr;
 }
@@ -747,19 +804,7 @@ string For::_toString(bool with_t) const {
 }
 
 llvm::Value* For::_codegen(Program& p, LLVMHelper& h) {
-	return Lets(
-		List<Field>({
-			new Field(name, "int32", first),
-			new Field("_last", "int32", last) // underscore starting identifier for privacy
-		}),
-		new While(
-			new Binary(Binary::LOWER_EQUAL, new Identifier(name), new Identifier("_last")),
-			new Block({
-				body,
-				make_shared<Assign>(name, new Binary(Binary::PLUS, new Identifier(name), new Integer(1))),
-			})
-		)
-	)._codegen(p, h);
+	return desugared->_codegen(p, h);
 }
 
 /***** Let *****/
@@ -772,28 +817,18 @@ string Let::_toString(bool with_t) const {
 }
 
 llvm::Value* Let::_codegen(Program& p, LLVMHelper& h) {
-	llvm::Type* let_t = h.asType(type);
-
-	if (let_t) {
-		llvm::Value* casted = nullptr;
-
-		if (init) {
-			init->codegen(p, h);
-
-			if (isUnit(init->getType()) and isUnit(let_t));
-			else {
-				casted = castToTargetTy(p, h, init->getValue(), let_t);
+	llvm::Type* let_t = resolved.getType(h);
+	llvm::Value* value = nullptr;
 
-				if (not casted)
-					h.errors.push_back({init->pos, "expected type '" + type + "', but got initializer of type '" + asString(init->getType()) + "'"});
-			}
-		}
-
-		// Allocate and store variable
-		h.alloc(name, let_t);
-		h.store(name, casted ? casted : h.defaultValue(let_t));
+	if (init) {
+		init->codegen(p, h);
+		value = castToTargetTy(h, init->getValue(), init->getType(), resolved);
 	} else
-		h.errors.push_back({this->pos, "unknown type '" + type + "'"});
+		value = h.defaultValue(let_t);
+
+	// Allocate and store variable
+	h.alloc(name, let_t);
+	h.store(name, value);
 
 	scope->codegen(p, h);
 
@@ -810,12 +845,7 @@ string Lets::_toString(bool with_t) const {
 }
 
 llvm::Value* Lets::_codegen(Program& p, LLVMHelper& h) {
-	shared_ptr<Expr> x = scope;
-
-	for (auto it = fields.rbegin(); it != fields.rend(); ++it)
-		x = make_shared<Let>((*it)->name, (*it)->type, (*it)->init, x); // recursive
-
-	return x->_codegen(p, h);
+	return desugared->_codegen(p, h);
 }
 
 /***** Assign *****/
@@ -827,46 +857,23 @@ string Assign::_toString(bool with_t) const {
 llvm::Value* Assign::_codegen(Program& p, LLVMHelper& h) {
 	value->codegen(p, h);
 
-	// Search self's fields
-	llvm::Value* self = Self()._codegen(p, h);
-	shared_ptr<Class> c = self ? p.classes_table[asString(self->getType())] : nullptr;
-
-	// Get target type
-	llvm::Type* target_t = nullptr;
-
-	if (h.contains(name))
-		target_t = h.getType(name);
-	else if (c and c->fields_table.find(name) != c->fields_table.end())
-		target_t = c->fields_table[name]->getType();
-	else {
-		h.errors.push_back({this->pos, "assignation to undeclared identifier " + name});
-		return nullptr;
-	}
-
 	// Cast value to target type
-	llvm::Value* casted = nullptr;
-
-	if (isUnit(value->getType()) and isUnit(target_t));
-	else {
-		casted = castToTargetTy(p, h, value->getValue(), target_t);
-
-		if (not casted) {
-			h.errors.push_back({value->pos, "expected type '" + asString(target_t) + "', but got r-value of type '" + asString(value->getType()) + "'"});
-			return nullptr;
-		}
-	}
+	llvm::Value* casted = castToTargetTy(h, value->getValue(), value->getType(), _type);
 
 	// Store casted value
-	if (h.contains(name))
+	if (not field)
 		h.store(name, casted);
-	else if (not isUnit(target_t))
+	else if (not _type.isUnit()) {
+		count(h, field);
+
 		h.builder->CreateStore(
 			casted,
 			h.builder->CreateStructGEP(
-				self,
-				c->fields_table[name]->idx
+				Self()._codegen(p, h),
+				field->idx
 			)
 		);
+	}
 
 	return casted;
 }
@@ -885,39 +892,17 @@ string Unary::_toString(bool with_t) const {
 
 llvm::Value* Unary::_codegen(Program& p, LLVMHelper& h) {
 	value->codegen(p, h);
-	llvm::Type* value_t = value->getType();
-
-	llvm::Value* out = nullptr;
-	string expected;
 
 	switch (type) {
-		case NOT:
-			if (isBoolean(value_t))
-				return h.builder->CreateNot(value->getValue());
-			else {
-				out = h.defaultValue("bool");
-				expected = "bool";
-			}
-			break;
+		case NOT: return h.builder->CreateNot(value->getValue());
 		case MINUS:
-			if (isNumeric(value_t))
-				return h.builder->CreateNeg(value->getValue());
-			else {
-				out = h.defaultValue("int32");
-				expected = "int32 or double";
-			}
-			break;
-		case ISNULL:
-			if (isClass(value_t)) return h.builder->CreateIsNull(value->getValue());
-			else {
-				out = h.defaultValue("bool");
-				expected = "Object";
-			}
+			if (value->getType().kind == VType::DOUBLE)
+				return h.builder->CreateFNeg(value->getValue());
+			return h.builder->CreateNeg(value->getValue());
+		case ISNULL: return h.builder->CreateIsNull(value->getValue());
 	}
 
-	h.errors.push_back({value->pos, "expected type '" + expected + "', but got operand of type '" + asString(value_t) + "'"});
-
-	return out;
+	return nullptr;
 }
 
 /***** Binary *****/
@@ -944,152 +929,110 @@ string Binary::_toString(bool with_t) const {
 }
 
 llvm::Value* Binary::_codegen(Program& p, LLVMHelper& h) {
-	llvm::Value* out = nullptr;
-	string expected;
+	if (desugared) // 'and', 'or' and '!='
+		return desugared->_codegen(p, h);
+
+	left->codegen(p, h);
+	right->codegen(p, h);
+
+	const VType& left_t = left->getType();
+	const VType& right_t = right->getType();
+
+	llvm::Type* integer_t = llvm::Type::getInt32Ty(*h.context);
+	llvm::Type* real_t = llvm::Type::getDoubleTy(*h.context);
+
+	if (type == EQUAL) {
+		if (left_t == right_t) {
+			if (left_t.kind == VType::STRING) // length, then hash, then characters
+				return h.builder->CreateCall(
+					h.module->getOrInsertFunction(
+						"string_equal",
+						llvm::FunctionType::get(
+							llvm::Type::getInt1Ty(*h.context),
+							{
+								llvm::Type::getInt8PtrTy(*h.context),
+								llvm::Type::getInt8PtrTy(*h.context),
+							},
+							false
+						)
+					),
+					{left->getValue(), right->getValue()}
+				);
+			else if (left_t.isUnit())
+				return llvm::ConstantInt::getTrue(*h.context);
+			else if (left_t.kind == VType::DOUBLE)
+				return h.builder->CreateFCmpOEQ(left->getValue(), right->getValue());
+			else
+				return h.builder->CreateICmpEQ(left->getValue(), right->getValue());
+		} else if (left_t.isNumeric() and right_t.isNumeric())
+			return h.builder->CreateFCmpOEQ(
+				h.numericCast(left->getValue()),
+				h.numericCast(right->getValue())
+			);
 
-	switch (type) {
-		case AND:
-			return If(left, right, make_shared<Boolean>(false))._codegen(p, h);
-		case OR:
-			return If(left, make_shared<Boolean>(true), right)._codegen(p, h);
-		case NEQUAL:
-			return Unary(Unary::NOT, new Binary(EQUAL, left, right))._codegen(p, h);
-		default:
-			left->codegen(p, h);
-			right->codegen(p, h);
-
-			llvm::Type* left_t = left->getType();
-			llvm::Type* right_t = right->getType();
-
-			switch (type) {
-				case EQUAL:
-					if (isSameAs(left_t, right_t)) {
-						if (isString(left_t)) {
-							llvm::Value* comp = h.builder->CreateCall(
-								h.module->getOrInsertFunction(
-									"strcmp",
-									llvm::FunctionType::get(
-										h.asType("int32"),
-										{
-											llvm::Type::getInt8PtrTy(*h.context),
-											llvm::Type::getInt8PtrTy(*h.context),
-										},
-										false
-									)
-								),
-								{left->getValue(), right->getValue()}
-							);
-
-							return h.builder->CreateICmpEQ(comp, h.defaultValue("int32"));
-						} else if (isUnit(left_t))
-							return llvm::ConstantInt::getTrue(*h.context);
-						else if (isReal(left_t))
-							return h.builder->CreateFCmpOEQ(left->getValue(), right->getValue());
-						else
-							return h.builder->CreateICmpEQ(left->getValue(), right->getValue());
-					} else if (isNumeric(left_t) and isNumeric(right_t))
-						return h.builder->CreateFCmpOEQ(
-							h.numericCast(left->getValue()),
-							h.numericCast(right->getValue())
-						);
-					else if (isClass(left_t) and isClass(right_t)) {
-						llvm::Type* comm_t = p.commonAncestor(asString(left_t), asString(right_t))->getType(h)->getPointerTo();
-						return h.builder->CreateICmpEQ( // cast pointers to same type for address comparison
-							castToTargetTy(p, h, left->getValue(), comm_t),
-							castToTargetTy(p, h, right->getValue(), comm_t)
-						);
-					} else
-						h.errors.push_back({this->pos, "expected agreeing operand types, but got types '" + asString(left_t) + "' and '" + asString(right_t) + "'"});
-
-					return h.defaultValue("bool");
-				default:
-					if (isInteger(left_t) and isInteger(right_t)) {
-						switch (type) {
-							case LOWER: return h.builder->CreateICmpSLT(left->getValue(), right->getValue());
-							case LOWER_EQUAL: return h.builder->CreateICmpSLE(left->getValue(), right->getValue());
-							case GREATER: return h.builder->CreateICmpSGT(left->getValue(), right->getValue());
-							case GREATER_EQUAL: return h.builder->CreateICmpSGE(left->getValue(), right->getValue());
-							case PLUS: return h.builder->CreateAdd(left->getValue(), right->getValue());
-							case MINUS: return h.builder->CreateSub(left->getValue(), right->getValue());
-							case TIMES: return h.builder->CreateMul(left->getValue(), right->getValue());
-							case DIV: return h.builder->CreateSDiv(left->getValue(), right->getValue());
-							case POW:
-								return h.builder->CreateFPToSI(
-									h.builder->CreateCall(
-										h.module->getOrInsertFunction(
-											"llvm.powi.f64",
-											llvm::FunctionType::get(
-												h.asType("double"),
-												{
-													h.asType("double"),
-													h.asType("int32"),
-												},
-												false
-											)
-										),
-										{
-											h.builder->CreateSIToFP(
-												left->getValue(),
-												h.asType("double")
-											),
-											right->getValue()
-										}
-									),
-									h.asType("int32")
-								);
-							case MOD: return h.builder->CreateSRem(left->getValue(), right->getValue());
-							default: break;
-						}
-					} else if (isNumeric(left_t) and isNumeric(right_t)) {
-						llvm::Value* left_bis = h.numericCast(left->getValue());
-						llvm::Value* right_bis = h.numericCast(right->getValue());
-
-						switch (type) {
-							case LOWER: return h.builder->CreateFCmpOLT(left_bis, right_bis);
-							case LOWER_EQUAL: return h.builder->CreateFCmpOLE(left_bis, right_bis);
-							case GREATER: return h.builder->CreateFCmpOGT(left_bis, right_bis);
-							case GREATER_EQUAL: return h.builder->CreateFCmpOGE(left_bis, right_bis);
-							case PLUS: return h.builder->CreateFAdd(left_bis, right_bis);
-							case MINUS: return h.builder->CreateFSub(left_bis, right_bis);
-							case TIMES: return h.builder->CreateFMul(left_bis, right_bis);
-							case DIV: return h.builder->CreateFDiv(left_bis, right_bis);
-							case POW:
-								return h.builder->CreateCall(
-									h.module->getOrInsertFunction(
-										"llvm.pow.f64",
-										llvm::FunctionType::get(
-											h.asType("double"),
-											{
-												h.asType("double"),
-												h.asType("double"),
-											},
-											false
-										)
-									),
-									{left_bis, right_bis}
-								);
-							case MOD: return h.builder->CreateFRem(left_bis, right_bis);
-							default: break;
-						}
-					} else {
-						switch (type) {
-							case LOWER:
-							case LOWER_EQUAL:
-							case GREATER:
-							case GREATER_EQUAL:
-								out = h.defaultValue("bool");
-								break;
-							default:
-								out = h.defaultValue("int32");
-						}
-						expected = "int32 or double";
-					}
-			}
+		// Cast pointers to same type for address comparison
+		VType comm_t(VType::CLASS, Class::commonAncestor(left_t.c, right_t.c));
 
-			h.errors.push_back({this->pos, "expected type '" + expected + "', but got operand of types '" + asString(left_t) + "' and '" + asString(right_t) + "'"});
+		return h.builder->CreateICmpEQ(
+			castToTargetTy(h, left->getValue(), left_t, comm_t),
+			castToTargetTy(h, right->getValue(), right_t, comm_t)
+		);
 	}
 
-	return out;
+	if (left_t.kind == VType::INT32 and right_t.kind == VType::INT32) {
+		switch (type) {
+			case LOWER: return h.builder->CreateICmpSLT(left->getValue(), right->getValue());
+			case LOWER_EQUAL: return h.builder->CreateICmpSLE(left->getValue(), right->getValue());
+			case GREATER: return h.builder->CreateICmpSGT(left->getValue(), right->getValue());
+			case GREATER_EQUAL: return h.builder->CreateICmpSGE(left->getValue(), right->getValue());
+			case PLUS: return h.builder->CreateAdd(left->getValue(), right->getValue());
+			case MINUS: return h.builder->CreateSub(left->getValue(), right->getValue());
+			case TIMES: return h.builder->CreateMul(left->getValue(), right->getValue());
+			case DIV: return h.builder->CreateSDiv(left->getValue(), right->getValue());
+			case POW:
+				return h.builder->CreateFPToSI(
+					h.builder->CreateCall(
+						h.module->getOrInsertFunction(
+							"llvm.powi.f64",
+							llvm::FunctionType::get(real_t, {real_t, integer_t}, false)
+						),
+						{
+							h.builder->CreateSIToFP(left->getValue(), real_t),
+							right->getValue()
+						}
+					),
+					integer_t
+				);
+			case MOD: return h.builder->CreateSRem(left->getValue(), right->getValue());
+			default: break;
+		}
+	} else {
+		llvm::Value* left_bis = h.numericCast(left->getValue());
+		llvm::Value* right_bis = h.numericCast(right->getValue());
+
+		switch (type) {
+			case LOWER: return h.builder->CreateFCmpOLT(left_bis, right_bis);
+			case LOWER_EQUAL: return h.builder->CreateFCmpOLE(left_bis, right_bis);
+			case GREATER: return h.builder->CreateFCmpOGT(left_bis, right_bis);
+			case GREATER_EQUAL: return h.builder->CreateFCmpOGE(left_bis, right_bis);
+			case PLUS: return h.builder->CreateFAdd(left_bis, right_bis);
+			case MINUS: return h.builder->CreateFSub(left_bis, right_bis);
+			case TIMES: return h.builder->CreateFMul(left_bis, right_bis);
+			case DIV: return h.builder->CreateFDiv(left_bis, right_bis);
+			case POW:
+				return h.builder->CreateCall(
+					h.module->getOrInsertFunction(
+						"llvm.pow.f64",
+						llvm::FunctionType::get(real_t, {real_t, real_t}, false)
+					),
+					{left_bis, right_bis}
+				);
+			case MOD: return h.builder->CreateFRem(left_bis, right_bis);
+			default: break;
+		}
+	}
+
+	return nullptr;
 }
 
 /***** Call *****/
@@ -1100,74 +1043,45 @@ string Call::_toString(bool with_t) const { // improvement -> replace 'self' by
 
 llvm::Value* Call::_codegen(Program& p, LLVMHelper& h) {
 	scope->codegen(p, h);
-	llvm::Type* scope_t = scope->getType();
-
 	args.codegen(p, h);
 
-	if (isUnit(scope_t) or isClass(scope_t)) {
-		shared_ptr<Method> m;
-		llvm::Function* f = nullptr;
-		vector<llvm::Value*> params;
-
-		if (isUnit(scope_t) and p.functions_table.find(name) != p.functions_table.end()) { // top-level function
-			m = p.functions_table[name];
-			f = m->getFunction(h);
-		} else if (isClass(scope_t) or h.contains("self")) {
-			llvm::Value* obj = isUnit(scope_t) ? Self()._codegen(p, h) : scope->getValue();
-
-			shared_ptr<Class> c = p.classes_table[asString(obj->getType())];
-			if (c->methods_table.find(name) != c->methods_table.end()) { // class method
-				m = c->methods_table[name];
-
-				f = (llvm::Function*) h.builder->CreateLoad(
-					h.builder->CreateStructGEP(
-						h.builder->CreateLoad(
-							h.builder->CreateStructGEP(obj, 0)
-						), // obj->vtable
-						m->idx
-					) // vtable->method
-				); // vtable->method
-
-				// Add obj as self param
-				params.push_back(obj);
-			}
-		}
+	vector<llvm::Value*> params;
 
-		if (f) {
-			int n = m->formals.size();
+	// Add object as self param
+	if (c)
+		params.push_back(scope->getType().isUnit() ? Self()._codegen(p, h) : scope->getValue());
 
-			// Compare call with signature
-			if (args.size() == n or (m->variadic and args.size() > n)) {
-				bool valid = true;
+	size_t n = method->formals.size();
 
-				for (int i = 0; i < args.size(); ++i) {
-					llvm::Type* param_t = (i < n) ? m->formals[i]->getType(h) : args[i]->getType();
+	for (size_t i = 0; i < args.size(); ++i) {
+		const VType& arg_t = args[i]->getType();
+		const VType& param_t = i < n ? method->formals[i]->resolved : arg_t; // variadic
 
-					if (isUnit(args[i]->getType()) and isUnit(param_t));
-					else {
-						llvm::Value* casted = castToTargetTy(p, h, args[i]->getValue(), param_t);
+		if (not param_t.isUnit())
+			params.push_back(castToTargetTy(h, args[i]->getValue(), arg_t, param_t));
+	}
 
-						if (casted)
-							params.push_back(casted);
-						else {
-							h.errors.push_back({args[i]->pos, "expected type '" + asString(param_t) + "', but got return value of type '" + asString(args[i]->getType()) + "'"});
-							valid = false;
-						}
-					}
-				}
+	if (c)
+		return dispatch(p, h, c, method, params);
 
-				if (valid) // all arguments have the expected type
-					return h.builder->CreateCall(f, params);
-			} else
-				h.errors.push_back({this->pos, "call to method " + m->getName() + " with wrong number of arguments"});
-		} else
-			h.errors.push_back({this->pos, "call to undeclared method " + name});
-	} else
-		h.errors.push_back({scope->pos, "expected object type, but got scope of type '" + asString(scope_t) + "'"});
+	llvm::Value* value = h.builder->CreateCall(method->getFunction(h), params);
 
-	return nullptr;
-}
+	// C string of an external function, copied with a length and a hash (see LLVMHelper::literal)
+	if (not method->block and method->resolved.kind == VType::STRING)
+		return h.builder->CreateCall(
+			h.module->getOrInsertFunction(
+				h.gc ? "gc_string_from" : "string_from",
+				llvm::FunctionType::get(
+					llvm::Type::getInt8PtrTy(*h.context),
+					{llvm::Type::getInt8PtrTy(*h.context)},
+					false
+				)
+			),
+			{value}
+		);
 
+	return value;
+}
 
 /***** New *****/
 
@@ -1176,14 +1090,7 @@ string New::_toString(bool with_t) const {
 }
 
 llvm::Value* New::_codegen(Program& p, LLVMHelper& h) {
-	llvm::Function* f = h.module->getFunction(type + "__new");
-
-	if (not f) {
-		h.errors.push_back({this->pos, "new instance of unknown object type '" + type + "'"});
-		return nullptr;
-	}
-
-	return h.builder->CreateCall(f, {});
+	return h.builder->CreateCall(h.module->getFunction(_type.c->name + "__new"), {});
 }
 
 /***** Identifier *****/
@@ -1194,28 +1101,21 @@ string Identifier::_toString(bool with_t) const {
 
 llvm::Value* Identifier::_codegen(Program& p, LLVMHelper& h) {
 	// Load from scope
-	if (h.contains(id))
+	if (not field)
 		return h.load(id);
 
-	// Search self's fields
-	llvm::Value* self = Self()._codegen(p, h);
-	shared_ptr<Class> c = self ? p.classes_table[asString(self->getType())] : nullptr;
-
-	if (c and c->fields_table.find(id) != c->fields_table.end()) {
-		if (not isUnit(c->fields_table[id]->getType()))
-			return h.builder->CreateLoad(
-				h.builder->CreateStructGEP(
-					self,
-					c->fields_table[id]->idx
-				)
-			); // self->id
-		else
-			return nullptr;
-	}
+	// Self's field
+	if (field->resolved.isUnit())
+		return nullptr;
 
-	h.errors.push_back({this->pos, "undeclared identifier " + id});
+	count(h, field);
 
-	return nullptr;
+	return h.builder->CreateLoad(
+		h.builder->CreateStructGEP(
+			Self()._codegen(p, h),
+			field->idx
+		)
+	); // self->id
 }
 
 /***** Self *****/
@@ -1227,7 +1127,7 @@ llvm::Value* Identifier::_codegen(Program& p, LLVMHelper& h) {
  * @see Method::_codegen
  */
 llvm::Value* Self::_codegen(Program& p, LLVMHelper& h) {
-	return h.getValue("self");
+	return h.getValue(symbols::self);
 }
 
 /***** Integer *****/
@@ -1237,7 +1137,7 @@ string Integer::_toString(bool with_t) const {
 }
 
 llvm::Value* Integer::_codegen(Program& p, LLVMHelper& h) {
-	return llvm::ConstantInt::get(h.asType("int32"), value);
+	return llvm::ConstantInt::get(llvm::Type::getInt32Ty(*h.context), value);
 }
 
 /***** Real *****/
@@ -1247,7 +1147,7 @@ string Real::_toString(bool with_t) const {
 }
 
 llvm::Value* Real::_codegen(Program& p, LLVMHelper& h) {
-	return llvm::ConstantFP::get(h.asType("double"), value);
+	return llvm::ConstantFP::get(llvm::Type::getDoubleTy(*h.context), value);
 }
 
 /***** Boolean ****/
@@ -1257,28 +1157,17 @@ string Boolean::_toString(bool with_t) const {
 }
 
 llvm::Value* Boolean::_codegen(Program& p, LLVMHelper& h) {
-	return llvm::ConstantInt::get(h.asType("bool"), b);
+	return llvm::ConstantInt::get(llvm::Type::getInt1Ty(*h.context), b);
 }
 
 /***** String *****/
 
 string String::_toString(bool with_t) const {
-	string temp;
-	for (const char& c: str)
-		switch (c) {
-			case '\"':
-			case '\\': temp += char2hex(c); break;
-			default:
-				if (c >= 32 and c <= 126)
-					temp += c;
-				else
-					temp += char2hex(c);
-		}
-	return "\"" + temp + "\"";
+	return "\"" + str2esc(str.data(), str.size()) + "\"";
 }
 
 llvm::Value* String::_codegen(Program& p, LLVMHelper& h) {
-	return h.builder->CreateGlobalStringPtr(str, "str");
+	return h.literal(str);
 }
 
 /***** Unit *****/
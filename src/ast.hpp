@@ -1,22 +1,74 @@
 #ifndef AST_H
 #define AST_H
 
+#include "arena.hpp"
 #include "llvm.hpp"
+#include "symbol.hpp"
 
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 
 class Program; // forward declaration
+class Class; // forward declaration
+class ASTWriter; // see serial.hpp
+class SemanticHelper; // see semantic.hpp
+
+/// Frequent symbols, interned once
+namespace symbols {
+	static const Symbol self("self");
+
+	static const Symbol unit("unit"), int32("int32"), double_("double"), bool_("bool"), string("string");
+
+	static const Symbol Object("Object"), Main("Main"), main("main");
+}
+
+/**
+ * VSOP type, as resolved by the semantic analysis
+ *
+ * @note Class types refer to their class node, such that neither the analysis nor the code generation looks types up by name.
+ * @see Program::resolve
+ */
+struct VType {
+	enum Kind { UNIT, INT32, DOUBLE, BOOL, STRING, CLASS };
+
+	VType(Kind kind=UNIT, Class* c=nullptr): kind(kind), c(c) {}
+
+	Kind kind;
+	Class* c; // if CLASS
+
+	bool isUnit() const { return kind == UNIT; }
+	bool isNumeric() const { return kind == INT32 or kind == DOUBLE; }
+	bool isClass() const { return kind == CLASS; }
+
+	bool operator==(const VType& t) const { return kind == t.kind and c == t.c; }
+	bool operator!=(const VType& t) const { return not (*this == t); }
+
+	/**
+	 * Whether a value of this type can be assigned to the other type
+	 *
+	 * @note Numeric types convert into each other and classes into their ancestors.
+	 */
+	bool conformsTo(const VType& t) const;
+
+	std::string toString() const;
+
+	/// Associated LLVM type
+	llvm::Type* getType(LLVMHelper&) const;
+};
 
 /**
  * AST abstract node
+ *
+ * @note Nodes are owned by an arena (see Arena) and refer to each other by plain pointers.
+ * @remark The destructor is not virtual, nodes are never deleted through a base pointer. Therefore, most nodes are
+ * trivially destructible and are not even visited when their arena is released.
  */
 class Node {
 	public:
 		Node() {}
-		virtual ~Node() {}
 
 		/// Position in the parsed file
 		Position pos = { 1, 1 };
@@ -24,8 +76,17 @@ class Node {
 		/// Produce string representation, with or without type augmentation
 		virtual std::string toString(bool with_t=false) const = 0;
 
+		/// Check types and scopes
+		virtual void check(Program& p, SemanticHelper& s) {}
+
 		/// Generate code
 		virtual void codegen(Program& p, LLVMHelper& h) {}
+
+		/// Write the node in binary form (see serial.hpp)
+		virtual void serialize(ASTWriter&) const = 0;
+
+	protected:
+		~Node() = default;
 };
 
 /**
@@ -33,27 +94,20 @@ class Node {
  *
  * @tparam T the type of stored nodes
  *
- * @remark Nodes are stored with smart pointers, so that memory is automatically managed. Therefore, one should avoid to deallocate the nodes manually.
+ * @remark Nodes are stored as plain pointers, they are owned by an arena. Therefore, one should not deallocate the nodes manually.
+ * @note The pointers of a parsed (or loaded) list are stored contiguously in the arena of its nodes as well, such that a
+ * node with children makes no allocation of its own. Other lists (e.g. the whole program) are on the heap.
  */
 template <typename T>
-class List: public std::vector<std::shared_ptr<T>>, public Node {
+class List: public std::vector<T*, ArenaAllocator<T*>>, public Node {
 	public:
 		List() {}
-		List(std::initializer_list<std::shared_ptr<T>> init) {
-			for(std::shared_ptr<T> t: init)
-				this->push(t);
-		}
-		List(std::initializer_list<T*> init) {
-			for(T* t: init)
-				this->push(t);
-		}
+		explicit List(Arena& arena): std::vector<T*, ArenaAllocator<T*>>(ArenaAllocator<T*>(&arena)) {}
+		List(std::initializer_list<T*> init): std::vector<T*, ArenaAllocator<T*>>(init) {}
 
 		/// Push node at the back of the list
-		void push(std::shared_ptr<T> t) {
-			return this->push_back(t);
-		}
 		void push(T* t) {
-			return this->push(std::shared_ptr<T>(t));
+			return this->push_back(t);
 		}
 
 		/// Reverse the list
@@ -74,10 +128,17 @@ class List: public std::vector<std::shared_ptr<T>>, public Node {
 			return str + "]";
 		}
 
+		virtual void check(Program& p, SemanticHelper& s) {
+			for (T* t: *this)
+				t->check(p, s);
+		}
+
 		virtual void codegen(Program& p, LLVMHelper& h) {
-			for (std::shared_ptr<T> t: *this)
+			for (T* t: *this)
 				t->codegen(p, h);
 		}
+
+		virtual void serialize(ASTWriter&) const {} // see ASTWriter::list
 };
 
 /**
@@ -88,12 +149,17 @@ class Expr: public Node {
 		virtual std::string toString(bool with_t=false) const {
 			std::string str = this->_toString(with_t);
 			if (with_t)
-				str += ":" + asString(this->getType());
+				str += ":" + _type.toString();
 			return str;
 		}
 
+		virtual void check(Program& p, SemanticHelper& s) {
+			_type = this->_check(p, s);
+		}
+
+		/// @note With -gc, the value is rooted if it is an object or a string (see LLVMHelper::retain).
 		virtual void codegen(Program& p, LLVMHelper& h) {
-			_value = this->_codegen(p, h);
+			_value = h.retain(this->_codegen(p, h));
 		}
 
 		/**
@@ -103,17 +169,28 @@ class Expr: public Node {
 		 */
 		virtual std::string _toString(bool with_t=false) const = 0;
 
+		/**
+		 * Auxilary function for check
+		 *
+		 * @see check
+		 */
+		virtual VType _check(Program&, SemanticHelper&) = 0;
+
 		/**
 		 * Auxilary function for codegen
 		 *
+		 * @warning should be preceeded by check, without errors
 		 * @see codegen
 		 */
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&) = 0;
 
 		llvm::Value* getValue() const { return _value; }
-		llvm::Type* getType() const { return _value ? _value->getType() : nullptr; }
+		const VType& getType() const { return _type; }
 
 	protected:
+		/// VSOP type
+		VType _type;
+
 		/// LLVM value
 		llvm::Value* _value = nullptr;
 };
@@ -124,19 +201,23 @@ class Expr: public Node {
 class Block: public Expr {
 	public:
 		Block() {}
-		Block(const List<Expr>& exprs): exprs(exprs) {}
+		Block(List<Expr> exprs): exprs(std::move(exprs)) {}
 
 		/// List of expressions
 		List<Expr> exprs;
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Field; // forward declaration
 class Method; // forward declaration
 
 struct ClassDefinition {
+	explicit ClassDefinition(Arena& arena): fields(arena), methods(arena) {}
+
 	List<Field> fields;
 	List<Method> methods;
 };
@@ -146,27 +227,51 @@ struct ClassDefinition {
  */
 class Class: public Node {
 	public:
-		Class(const std::string& name, const std::string& parent, const List<Field>& fields, const List<Method>& methods):
-			name(name), parent_name(parent), fields(fields), methods(methods) {}
+		Class(Symbol name, Symbol parent, List<Field> fields, List<Method> methods):
+			name(name), parent_name(parent), fields(std::move(fields)), methods(std::move(methods)) {}
 
-		std::string name, parent_name;
+		Symbol name, parent_name;
 
 		List<Field> fields;
-		std::unordered_map<std::string, std::shared_ptr<Field>> fields_table;
+		std::unordered_map<Symbol, Field*> fields_table;
 		List<Method> methods;
-		std::unordered_map<std::string, std::shared_ptr<Method>> methods_table;
+		std::unordered_map<Symbol, Method*> methods_table;
 
 		Class* parent = nullptr; // parent pointer
+		bool declared = false;
+
+		/// End of the last field of an instance, in bytes (see declaration)
+		unsigned size = 8; // vtable pointer
 
 		virtual std::string toString(bool with_t=false) const;
+		virtual void check(Program&, SemanticHelper&);
 		virtual void codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
+
+		/**
+		 * Check the fields and methods of the class, and build its tables
+		 *
+		 * @note The parent is declared first, if needed.
+		 * @remark The new fields are laid out after the parent's ones, such that an instance is also an instance of
+		 * its parent. They are ordered to minimize the padding, the most accessed ones first if profiled.
+		 */
+		void declaration(Program&, SemanticHelper&);
 
 		/**
 		 * Declare and define the class structure
 		 *
 		 * @note The class vtable is also builded.
+		 * @warning should be preceeded by declaration, in any module
 		 */
-		void declaration(LLVMHelper&);
+		void declare(LLVMHelper&);
+
+		/**
+		 * Pointer map of an instance, for the garbage collector (-gc)
+		 *
+		 * @return the number of object and string fields followed by their offsets, as i32, or null if none
+		 * @warning should be preceeded by declare
+		 */
+		llvm::Constant* pointers(LLVMHelper&);
 
 		std::string getStructName() const {
 			return "struct." + name;
@@ -201,19 +306,23 @@ class Class: public Node {
  */
 class Field: public Expr {
 	public:
-		Field(const std::string& name, const std::string& type, Expr* init):
-			name(name), type(type), init(init) {}
-		Field(const std::string& name, const std::string& type, std::shared_ptr<Expr> init):
+		Field(Symbol name, Symbol type, Expr* init):
 			name(name), type(type), init(init) {}
 
-		std::string name, type;
-		std::shared_ptr<Expr> init; // possibly null
+		Symbol name, type;
+		Expr* init; // possibly null
+
+		Class* parent = nullptr; // parent pointer
 		unsigned idx; // index in parent structure
 
+		VType resolved; // type of the field
+
 		virtual std::string _toString(bool with_t=false) const { return ""; }
 		virtual std::string toString(bool with_t=false) const;
 
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 /**
@@ -223,14 +332,17 @@ class Field: public Expr {
  */
 class Formal: public Node {
 	public:
-		Formal(const std::string& name, const std::string& type): name(name), type(type) {}
+		Formal(Symbol name, Symbol type): name(name), type(type) {}
+
+		Symbol name, type;
 
-		std::string name, type;
+		VType resolved;
 
 		virtual std::string toString(bool with_t=false) const;
+		virtual void serialize(ASTWriter&) const;
 
 		llvm::Type* getType(LLVMHelper& h) const {
-			return h.asType(type);
+			return resolved.getType(h);
 		}
 };
 
@@ -239,31 +351,40 @@ class Formal: public Node {
  */
 class Method: public Node {
 	public:
-		Method(const std::string& name, const List<Formal>& formals, const std::string& type, Block* block, bool variadic=false):
-			name(name), formals(formals), type(type), block(block), variadic(variadic) {}
-		Method(const std::string& name, const List<Formal>& formals, const std::string& type, std::shared_ptr<Block> block, bool variadic=false):
-			name(name), formals(formals), type(type), block(block), variadic(variadic) {}
+		Method(Symbol name, List<Formal> formals, Symbol type, Block* block, bool variadic=false):
+			name(name), formals(std::move(formals)), type(type), block(block), variadic(variadic) {}
 
-		std::string name, type;
+		Symbol name, type;
 		bool variadic; // variable number of args
 
 		List<Formal> formals;
-		std::unordered_map<std::string, std::shared_ptr<Formal>> formals_table;
+		std::unordered_map<Symbol, Formal*> formals_table;
 
-		std::shared_ptr<Block> block;
+		Block* block; // null if external
 
 		Class* parent = nullptr; // parent pointer
 		unsigned idx; // index in parent vtable
 
+		VType resolved; // return type
+
 		virtual std::string toString(bool with_t=false) const;
+		virtual void check(Program&, SemanticHelper&);
 		virtual void codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 
 		/**
-		 * Declare the method prototype in the module
+		 * Check the prototype of the method
 		 *
-		 * @note If invalid, the prototype is not declared.
+		 * @return false if invalid, in which case the method should be discarded
 		 */
-		void declaration(LLVMHelper&);
+		bool declaration(Program&, SemanticHelper&);
+
+		/**
+		 * Declare the method prototype in the module, if not already declared
+		 *
+		 * @warning should be preceeded by declaration
+		 */
+		void declare(LLVMHelper&);
 
 		std::string getName(bool colons=false) const {
 			return (parent ? parent->name + (colons ? "::" : "_") : "") + name;
@@ -282,123 +403,164 @@ class Method: public Node {
  */
 class Program: public Node {
 	public:
-		Program(const List<Class>& classes): classes(classes) {}
-		Program(const List<Class>& classes, const List<Method>& functions):
-			classes(classes), functions(functions) {}
+		Program(List<Class> classes): classes(std::move(classes)) {}
+		Program(List<Class> classes, List<Method> functions):
+			classes(std::move(classes)), functions(std::move(functions)) {}
 
 		List<Class> classes;
-		std::unordered_map<std::string, std::shared_ptr<Class>> classes_table;
+		std::unordered_map<Symbol, Class*> classes_table;
 
 		List<Method> functions;
-		std::unordered_map<std::string, std::shared_ptr<Method>> functions_table;
+		std::unordered_map<Symbol, Method*> functions_table;
+
+		/// Nodes created by the program itself (e.g. Object, desugared expressions)
+		Arena arena;
+
+		/// (new Main).main(), if the entry point is a method
+		Expr* main = nullptr;
 
 		virtual std::string toString(bool with_t=false) const;
+		virtual void check(Program&, SemanticHelper&);
 		virtual void codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 
-		/// Declare and all classes and functions
-		void declaration(LLVMHelper&);
+		/// Check all classes and functions prototypes, and build the tables
+		void declaration(SemanticHelper&);
 
-		bool isSubclassOf(const std::string& a, const std::string& b) {
-			auto ita = classes_table.find(a);
-			auto itb = classes_table.find(b);
+		/**
+		 * Declare all classes and functions in a module
+		 *
+		 * @warning should be preceeded by declaration and check
+		 */
+		void declare(LLVMHelper&);
 
-			if (ita != classes_table.end() and itb != classes_table.end())
-				return Class::isSubclassOf(ita->second.get(), itb->second.get());
+		/// Check the entry point
+		void entry(Program&, SemanticHelper&);
 
-			return false;
-		}
+		/// Generate the 'main' function, if needed
+		void entry(Program&, LLVMHelper&);
 
-		Class* commonAncestor(const std::string& a, const std::string& b) {
-			auto ita = classes_table.find(a);
-			auto itb = classes_table.find(b);
+		/**
+		 * Define the field access counters and write them when main returns (-field-layout-instrument)
+		 *
+		 * @note The counts are appended to the file as '<class> <field> <count>' lines.
+		 * @see SemanticHelper::accesses
+		 */
+		void instrument(LLVMHelper&);
 
-			if (ita != classes_table.end() and itb != classes_table.end())
-				return Class::commonAncestor(ita->second.get(), itb->second.get());
+		/**
+		 * Resolve a type name
+		 *
+		 * @return false if the type is unknown
+		 */
+		bool resolve(Symbol name, VType& t) const;
 
-			return nullptr;
-		}
+		/**
+		 * Implementations of a method by a class and its subclasses
+		 *
+		 * @note As the whole program is known (class hierarchy analysis), the implementations are exhaustive.
+		 */
+		const std::vector<Method*>& implementations(Class* c, Symbol name);
+
+	private:
+		/// Storage for implementations, with (<class>, <method>) symbols keys
+		std::unordered_map<uint64_t, std::vector<Method*>> implementations_table;
+		std::mutex implementations_mutex; // modules may be generated concurrently
 };
 
 class If: public Expr {
 	public:
 		If(Expr* cond, Expr* then, Expr* els): cond(cond), then(then), els(els) {}
-		If(std::shared_ptr<Expr> cond, std::shared_ptr<Expr> then, std::shared_ptr<Expr> els):
-			cond(cond), then(then), els(els) {}
 
-		std::shared_ptr<Expr> cond, then, els;
+		Expr *cond, *then, *els; // els possibly null
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class While: public Expr {
 	public:
 		While(Expr* cond, Expr* body): cond(cond), body(body) {}
-		While(std::shared_ptr<Expr> cond, std::shared_ptr<Expr> body): cond(cond), body(body) {}
 
-		std::shared_ptr<Expr> cond, body;
+		Expr *cond, *body;
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Break: public Expr {
 	public:
 		virtual std::string toString(bool) const { return "break"; }
 		virtual std::string _toString(bool) const { return "break"; }
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class For: public Expr { // -ext
 	public:
-		For(const std::string& name, Expr* first, Expr* last, Expr* body):
-			name(name), first(first), last(last), body(body) {}
-		For(const std::string& name, std::shared_ptr<Expr> first, std::shared_ptr<Expr> last, std::shared_ptr<Expr> body):
+		For(Symbol name, Expr* first, Expr* last, Expr* body):
 			name(name), first(first), last(last), body(body) {}
 
-		std::string name;
-		std::shared_ptr<Expr> first, last, body;
+		Symbol name;
+		Expr *first, *last, *body;
+
+		Expr* desugared = nullptr; // Lets and While, built by check
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Let: public Expr {
 	public:
-		Let(const std::string& name, const std::string& type, Expr* init, Expr* scope):
-			name(name), type(type), init(init), scope(scope) {}
-		Let(const std::string& name, const std::string& type, std::shared_ptr<Expr> init, std::shared_ptr<Expr> scope):
+		Let(Symbol name, Symbol type, Expr* init, Expr* scope):
 			name(name), type(type), init(init), scope(scope) {}
 
-		std::string name, type;
-		std::shared_ptr<Expr> init, scope;
+		Symbol name, type;
+		Expr *init, *scope; // init possibly null
+
+		VType resolved; // type of the variable
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Lets: public Expr { // -ext
 	public:
-		Lets(const List<Field>& fields, Expr* scope): fields(fields), scope(scope) {}
-		Lets(const List<Field>& fields, std::shared_ptr<Expr> scope): fields(fields), scope(scope) {}
+		Lets(List<Field> fields, Expr* scope): fields(std::move(fields)), scope(scope) {}
 
 		List<Field> fields;
-		std::shared_ptr<Expr> scope;
+		Expr* scope;
+
+		Expr* desugared = nullptr; // nested Let, built by check
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Assign: public Expr {
 	public:
-		Assign(std::string name, Expr* value): name(name), value(value) {}
-		Assign(std::string name, std::shared_ptr<Expr> value): name(name), value(value) {}
+		Assign(Symbol name, Expr* value): name(name), value(value) {}
+
+		Symbol name;
+		Expr* value;
 
-		std::string name;
-		std::shared_ptr<Expr> value;
+		Field* field = nullptr; // if the target is a field of self
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Unary: public Expr {
@@ -406,13 +568,14 @@ class Unary: public Expr {
 		enum Type { NOT, MINUS, ISNULL };
 
 		Unary(Type type, Expr* value): type(type), value(value) {}
-		Unary(Type type, std::shared_ptr<Expr> value): type(type), value(value) {}
 
 		Type type;
-		std::shared_ptr<Expr> value;
+		Expr* value;
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Binary: public Expr {
@@ -420,56 +583,69 @@ class Binary: public Expr {
 		enum Type {AND, OR, EQUAL, NEQUAL, LOWER, LOWER_EQUAL, GREATER, GREATER_EQUAL, PLUS, MINUS, TIMES, DIV, POW, MOD };
 
 		Binary(Type type, Expr* left, Expr* right): type(type), left(left), right(right) {}
-		Binary(Type type, std::shared_ptr<Expr> left, std::shared_ptr<Expr> right):
-			type(type), left(left), right(right) {}
 
 		Type type;
-		std::shared_ptr<Expr> left, right;
+		Expr *left, *right;
+
+		Expr* desugared = nullptr; // for 'and', 'or' and '!=', built by check
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Call: public Expr {
 	public:
-		Call(Expr* scope, const std::string& name, const List<Expr>& args):
-			scope(scope), name(name), args(args) {}
-		Call(std::shared_ptr<Expr> scope, const std::string& name, const List<Expr>& args):
-			scope(scope), name(name), args(args) {}
+		Call(Expr* scope, Symbol name, List<Expr> args):
+			scope(scope), name(name), args(std::move(args)) {}
 
-		std::shared_ptr<Expr> scope;
-		std::string name;
+		Expr* scope;
+		Symbol name;
 		List<Expr> args;
 
+		Method* method = nullptr; // resolved method or function
+		Class* c = nullptr; // static class of the object, if a method
+
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class New: public Expr {
 	public:
-		New(const std::string& type): type(type) {}
+		New(Symbol type): type(type) {}
 
-		std::string type;
+		Symbol type;
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Identifier: public Expr {
 	public:
-		Identifier(const std::string& id): id(id) {}
+		Identifier(Symbol id): id(id) {}
+
+		Symbol id;
 
-		std::string id;
+		Field* field = nullptr; // if a field of self
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Self: public Identifier {
 	public:
-		Self(): Identifier("self") {}
+		Self(): Identifier(symbols::self) {}
 
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Integer: public Expr {
@@ -479,7 +655,9 @@ class Integer: public Expr {
 		int value;
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Real: public Expr {
@@ -489,7 +667,9 @@ class Real: public Expr {
 		double value;
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Boolean: public Expr {
@@ -499,7 +679,9 @@ class Boolean: public Expr {
 		bool b;
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 
@@ -510,13 +692,17 @@ class String: public Expr {
 		std::string str;
 
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 class Unit: public Expr {
 	public:
 		virtual std::string _toString(bool) const;
+		virtual VType _check(Program&, SemanticHelper&);
 		virtual llvm::Value* _codegen(Program&, LLVMHelper&);
+		virtual void serialize(ASTWriter&) const;
 };
 
 #endif
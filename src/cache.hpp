@@ -0,0 +1,209 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA1.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <utime.h>
+
+/**
+ * Content-addressed compilation cache
+ *
+ * Entries are stored in '$XDG_CACHE_HOME/vsopc/' (or '~/.cache/vsopc/') and named
+ * after the hash of their key, i.e. of everything the compilation depends on.
+ *
+ * @note The total size of the entries is bounded, least recently used entries are evicted first.
+ */
+class Cache {
+	public:
+		/**
+		 * @param limit maximum total size of the entries, in bytes
+		 */
+		Cache(size_t limit=256 << 20): limit(limit) {
+			if (const char* xdg = std::getenv("XDG_CACHE_HOME"))
+				directory = xdg;
+			else if (const char* home = std::getenv("HOME"))
+				directory = std::string(home) + "/.cache";
+
+			if (not directory.empty())
+				directory += "/vsopc";
+		}
+
+		/// Add a component to the key
+		void update(llvm::StringRef str) {
+			sha.update(str);
+			sha.update(llvm::StringRef("\0", 1)); // separator
+		}
+
+		/**
+		 * Look the key up
+		 *
+		 * @return whether the entry exists, in which case its content is retrieved
+		 * @warning should be preceeded by the update of all key components
+		 */
+		bool fetch(std::string& content) {
+			if (directory.empty())
+				return false;
+
+			std::string path = this->entry();
+			auto buffer = llvm::MemoryBuffer::getFile(path);
+
+			this->count(bool(buffer));
+
+			if (not buffer)
+				return false;
+
+			content = (*buffer)->getBuffer().str();
+			utime(path.c_str(), nullptr); // most recently used
+
+			return true;
+		}
+
+		/**
+		 * Store content under the key
+		 *
+		 * @note The entry is written in a temporary file and then renamed, such that concurrent compilations never see partial entries.
+		 */
+		void store(const std::string& content) {
+			if (directory.empty() or llvm::sys::fs::create_directories(directory))
+				return;
+
+			std::string path = this->entry();
+			std::string temp = path + ".tmp" + std::to_string(llvm::sys::Process::getProcessId());
+
+			std::ofstream out(temp, std::ios::binary);
+			out << content;
+			out.close();
+
+			if (not out or llvm::sys::fs::rename(temp, path))
+				llvm::sys::fs::remove(temp);
+			else
+				this->evict();
+		}
+
+		/// Print statistics about the cache
+		void stats(std::ostream& out) {
+			size_t size = 0;
+			std::vector<std::pair<llvm::sys::TimePoint<>, std::pair<std::string, size_t>>> entries = this->list(size);
+
+			unsigned hits = 0, misses = 0;
+			std::ifstream in(directory + "/stats");
+			in >> hits >> misses;
+
+			out << "cache: " << directory << std::endl;
+			out << "entries: " << entries.size() << std::endl;
+			out << "size: " << size << " bytes (limit " << limit << " bytes)" << std::endl;
+			out << "hits: " << hits << std::endl;
+			out << "misses: " << misses << std::endl;
+		}
+
+	private:
+		std::string directory;
+		size_t limit;
+
+		llvm::SHA1 sha;
+		std::string key;
+
+		/// Path of the entry associated to the key
+		std::string entry() {
+			if (key.empty())
+				key = llvm::toHex(sha.final(), true);
+
+			return directory + "/" + key;
+		}
+
+		/**
+		 * List the entries, least recently used first
+		 *
+		 * @param size total size of the entries
+		 */
+		std::vector<std::pair<llvm::sys::TimePoint<>, std::pair<std::string, size_t>>> list(size_t& size) {
+			std::vector<std::pair<llvm::sys::TimePoint<>, std::pair<std::string, size_t>>> entries;
+			std::error_code ec;
+
+			size = 0;
+
+			for (llvm::sys::fs::directory_iterator it(directory, ec), end; it != end and not ec; it.increment(ec)) {
+				llvm::StringRef name = llvm::sys::path::filename(it->path());
+				llvm::sys::fs::file_status st;
+
+				if (name.size() != 40 or llvm::sys::fs::status(it->path(), st)) // not an entry
+					continue;
+
+				entries.push_back({st.getLastModificationTime(), {it->path(), st.getSize()}});
+				size += st.getSize();
+			}
+
+			std::sort(entries.begin(), entries.end());
+
+			return entries;
+		}
+
+		/// Remove least recently used entries until the size limit is satisfied
+		void evict() {
+			size_t size;
+			auto entries = this->list(size);
+
+			for (auto it = entries.begin(); it != entries.end() and size > limit; ++it)
+				if (not llvm::sys::fs::remove(it->second.first))
+					size -= it->second.second;
+		}
+
+		/**
+		 * Count a hit or a miss
+		 *
+		 * @note The statistics are updated under an exclusive lock, such that concurrent compilations (e.g. the children
+		 * of a server) do not lose updates.
+		 */
+		void count(bool hit) {
+			if (llvm::sys::fs::create_directories(directory))
+				return;
+
+			int fd = open((directory + "/stats").c_str(), O_RDWR | O_CREAT, 0644);
+
+			if (fd < 0)
+				return;
+
+			if (flock(fd, LOCK_EX)) {
+				close(fd);
+				return;
+			}
+
+			unsigned hits = 0, misses = 0;
+
+			char buffer[64] = {};
+			if (read(fd, buffer, sizeof(buffer) - 1) > 0)
+				sscanf(buffer, "%u %u", &hits, &misses);
+
+			if (hit)
+				++hits;
+			else
+				++misses;
+
+			std::string str = std::to_string(hits) + ' ' + std::to_string(misses) + '\n';
+
+			if (ftruncate(fd, 0) == 0)
+				pwrite(fd, str.data(), str.size(), 0);
+
+			close(fd); // releases the lock
+		}
+};
+
+#endif
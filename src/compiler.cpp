@@ -0,0 +1,472 @@
+#include "vsopc.hpp"
+#include "mapping.hpp"
+#include "semantic.hpp"
+#include "serial.hpp"
+#include "tokens.hpp"
+#include "vsop.tab.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+namespace vsopc {
+
+/***** Phases *****/
+
+static llvm::TimerGroup phases("vsopc", "Compilation phases");
+
+static llvm::Timer lexing("lex", "Lexical analysis", phases);
+static llvm::Timer parsing("parse", "Lexical and syntax analysis", phases);
+static llvm::Timer declaring("declaration", "Declaration", phases);
+static llvm::Timer checking("check", "Semantic analysis", phases);
+static llvm::Timer generating("codegen", "Code generation", phases);
+static llvm::Timer linking("link", "Runtime linking", phases);
+static llvm::Timer optimizing("passes", "Validation and optimization", phases);
+static llvm::Timer emitting("emission", "Emission", phases);
+
+/**
+ * Compilation phase scope
+ *
+ * @remark A phase is timed if -time-phases and traced if -trace.
+ */
+struct Phase {
+	Phase(llvm::Timer& timer, const Options& options):
+		region(options.timing ? &timer : nullptr), scope(timer.getName(), "") {}
+
+	llvm::TimeRegion region;
+	llvm::TimeTraceScope scope;
+};
+
+/**
+ * Report the timings of the phases and of the LLVM passes (-time-phases) and write the trace file (-trace)
+ *
+ * @note The trace file is in the Chrome trace-event format.
+ */
+static void report(const Options& options, ostream& err) {
+	if (options.timing) {
+		llvm::raw_os_ostream os(err);
+
+		phases.print(os);
+		llvm::reportAndResetTimings(&os);
+
+		for (llvm::Timer* t: {&lexing, &parsing, &declaring, &checking, &generating, &linking, &optimizing, &emitting})
+			t->clear(); // do not report again at exit
+	}
+
+	if (llvm::timeTraceProfilerEnabled()) {
+		error_code ec;
+		llvm::raw_fd_ostream out(options.trace, ec, llvm::sys::fs::OF_Text);
+
+		if (ec)
+			err << "vsopc: error: " << options.trace << ": " << ec.message() << endl;
+		else
+			llvm::timeTraceProfilerWrite(out);
+
+		llvm::timeTraceProfilerCleanup();
+	}
+}
+
+/***** Workers *****/
+
+/**
+ * Run tasks 0 to n - 1 on a pool of threads
+ *
+ * @param jobs number of threads, the number of cores if 0
+ */
+static void parallel(size_t n, unsigned jobs, const function<void(size_t)>& task) {
+	if (jobs == 0)
+		jobs = max(1u, thread::hardware_concurrency());
+
+	atomic<size_t> next(0);
+
+	auto worker = [&]() {
+		for (size_t i; (i = next++) < n;)
+			task(i);
+	};
+
+	vector<thread> threads;
+
+	for (size_t j = 1; j < min<size_t>(jobs, n); ++j)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (thread& t: threads)
+		t.join();
+}
+
+/// Move the buffered outputs and errors of the sources to the streams, in order
+static void flush(vector<ostringstream>& outs, vector<ostringstream>& errs, ostream& out, ostream& err) {
+	for (size_t i = 0; i < outs.size(); ++i) {
+		out << outs[i].str();
+		err << errs[i].str();
+
+		outs[i].str("");
+		errs[i].str("");
+	}
+}
+
+/***** Compilation *****/
+
+/**
+ * Load a binary abstract syntax tree into a context, instead of parsing a source (-load-ast)
+ *
+ * @note The positions refer to the source of the tree if it was written from a single source, to the context otherwise.
+ */
+static void load(yycontext& ctx, const char* data, size_t size, const Options& options) {
+	ASTReader reader(data, size, ctx.arena);
+
+	if (options.stage == LEX) {
+		ctx.err << "vsopc: error: " << ctx.filename << ": cannot lex an abstract syntax tree" << endl;
+		++ctx.errs;
+	} else if (not reader.program(ctx.classes, ctx.functions, ctx.file)) {
+		ctx.err << "vsopc: error: " << ctx.filename << ": corrupted or incompatible abstract syntax tree" << endl;
+		++ctx.errs;
+	} else if (reader.files.size() == 1)
+		ctx.filename = reader.files.front();
+}
+
+/// Write a program as a binary abstract syntax tree (-emit-ast)
+static void save(const Program& program, const vector<Source>& sources, const Options& options, ostream& err) {
+	ofstream file(options.ast_file, ios::binary);
+
+	if (not file) {
+		err << "vsopc: error: " << options.ast_file << ": unable to open file" << endl;
+		return;
+	}
+
+	vector<string> filenames;
+
+	for (const Source& source: sources)
+		filenames.push_back(source.filename);
+
+	ASTWriter(file).program(program, filenames, options.ext);
+}
+
+/**
+ * Generate, optimize and emit each source in its own module, concurrently
+ *
+ * @note The runtime is linked into the first module, which also holds the entry point.
+ * @warning The program should be checked, without errors.
+ * @warning LLVM timers are not thread-safe, the workers are timed as a whole by the caller.
+ */
+static int modules(Program& program, const vector<Source>& sources, vector<yycontext>& contexts, const Options& options, Result& result) {
+	size_t n = sources.size();
+
+	vector<string> diagnostics(n);
+	vector<int> errs(n, 0);
+
+	result.objects.assign(n, "");
+
+	// Pass timings are not thread-safe either
+	unsigned jobs = options.timing ? 1 : options.jobs;
+
+	parallel(n, jobs, [&](size_t i) {
+		ostringstream err;
+		LLVMHelper helper("VSOP");
+
+		helper.err = &err;
+		helper.speed_level = options.speed_level;
+		helper.size_level = options.size_level;
+		helper.instrument = options.field_instrument;
+		helper.gc = options.gc;
+		helper.module->setSourceFileName(sources[i].filename);
+
+		if (helper.target(options.arch, options.cpu)) {
+			program.declare(helper);
+
+			for (Class* c: contexts[i].classes)
+				if (c->parent) // valid class
+					c->codegen(program, helper);
+
+			for (Method* f: contexts[i].functions) {
+				auto it = program.functions_table.find(f->name);
+
+				if (it != program.functions_table.end() and it->second == f) // valid function
+					f->codegen(program, helper);
+			}
+
+			if (i == 0) {
+				program.entry(program, helper);
+				errs[i] += helper.link(false); // other modules use the runtime
+			}
+
+			errs[i] += helper.passes();
+
+			if (errs[i] == 0) {
+				llvm::SmallString<0> buffer;
+				llvm::raw_svector_ostream os(buffer);
+
+				errs[i] += helper.emit(os);
+				result.objects[i] = buffer.str().str();
+			}
+		} else
+			++errs[i];
+
+		diagnostics[i] = err.str();
+	});
+
+	int total = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		contexts[i].err << diagnostics[i];
+		total += errs[i];
+	}
+
+	return total;
+}
+
+static Result pipeline(const vector<Source>& sources, const Options& options, ostream& out, ostream& err) {
+	Result result;
+
+	size_t n = sources.size();
+	int mode = options.stage == LEX ?
+		(options.ext ? START_EXT_LEXER : START_LEXER) :
+		(options.ext ? START_EXT_PARSER : START_PARSER);
+
+	// Contexts, with buffered streams if several sources
+	vector<ostringstream> outs(n > 1 ? n : 0), errs(n > 1 ? n : 0);
+	vector<yycontext> contexts;
+
+	contexts.reserve(n);
+
+	for (size_t i = 0; i < n; ++i) {
+		contexts.emplace_back(sources[i].filename, mode, n > 1 ? outs[i] : out, n > 1 ? errs[i] : err);
+		contexts.back().file = i;
+	}
+
+	auto errors = [&]() {
+		int total = 0;
+
+		for (yycontext& ctx: contexts)
+			total += ctx.errs;
+
+		return total;
+	};
+
+	/**
+	 * Lex and parse a source in place, or write its tokens (-lex-bin)
+	 *
+	 * @remark Binary token streams are parsed as sources, binary abstract syntax trees are loaded.
+	 */
+	auto analyze = [&](yycontext& ctx, char* buffer, size_t size) {
+		if (ast::is(buffer, size))
+			load(ctx, buffer, size, options);
+		else if (tokens::is(buffer, size))
+			yyreplay(ctx, buffer, size);
+		else if (options.stage == LEX and options.binary)
+			yydump(ctx, buffer, size);
+		else
+			yyread(ctx, buffer, size);
+	};
+
+	// Lexical and syntax analysis, concurrently
+	{
+		Phase phase(options.stage == LEX ? lexing : parsing, options);
+
+		parallel(n, options.jobs, [&](size_t i) {
+			if (sources[i].mapping)
+				analyze(contexts[i], sources[i].mapping->data(), sources[i].mapping->size());
+			else {
+				string buffer = sources[i].text + string(2, '\0');
+				analyze(contexts[i], &buffer[0], sources[i].text.size());
+			}
+		});
+	}
+
+	flush(outs, errs, out, err);
+
+	if (options.stage == LEX) {
+		result.errors = errors();
+		return result;
+	}
+
+	// Merge the sources into a single program
+	List<Class> classes;
+	List<Method> functions;
+
+	for (yycontext& ctx: contexts) {
+		classes.insert(classes.end(), ctx.classes.begin(), ctx.classes.end());
+		functions.insert(functions.end(), ctx.functions.begin(), ctx.functions.end());
+	}
+
+	// The nodes remain owned by the arenas of the contexts, which outlive the program
+	Program program(std::move(classes), std::move(functions));
+
+	if (not options.ast_file.empty() and errors() == 0)
+		save(program, sources, options, err);
+
+	if (options.stage == PARSE) {
+		out << program.toString(false) << endl;
+
+		result.errors = errors();
+		return result;
+	}
+
+	// Semantic analysis, without LLVM
+	SemanticHelper semantic;
+
+	if (not options.field_profile.empty()) { // '<class> <field> <count>' lines, possibly of several runs
+		ifstream profile(options.field_profile);
+
+		if (not profile) {
+			err << "vsopc: error: " << options.field_profile << ": unable to open file" << endl;
+
+			result.errors = 1;
+			return result;
+		}
+
+		string c, f;
+		uint64_t count;
+
+		while (profile >> c >> f >> count)
+			semantic.accesses[c + "." + f] += count;
+	}
+
+	{
+		Phase phase(declaring, options);
+		program.declaration(semantic);
+	}
+	{
+		Phase phase(checking, options);
+		program.check(program, semantic);
+	}
+
+	for (Error& e: semantic.errors)
+		contexts[e.pos.file].error(e.pos, "semantic error, " + e.msg);
+
+	flush(outs, errs, out, err);
+
+	if (options.stage == CHECK) {
+		out << program.toString(true) << endl;
+
+		result.errors = errors();
+		return result;
+	}
+
+	result.errors = errors();
+
+	if (result.errors) // no code generation
+		return result;
+
+	LLVMHelper helper("VSOP");
+
+	helper.err = &err;
+	helper.speed_level = options.speed_level;
+	helper.size_level = options.size_level;
+	helper.instrument = options.field_instrument;
+	helper.gc = options.gc;
+	helper.module->setSourceFileName(sources.front().filename);
+
+	bool exec = options.stage >= ASSEMBLY;
+
+	if (exec and not helper.target(options.arch, options.cpu)) {
+		result.errors = 1;
+		return result;
+	}
+
+	// Multi-file program, one module per source
+	if (n > 1 and options.stage == OBJECT) {
+		{
+			Phase phase(generating, options);
+			result.errors = modules(program, sources, contexts, options, result);
+		}
+
+		flush(outs, errs, out, err);
+
+		if (result.errors)
+			result.objects.clear();
+
+		return result;
+	}
+
+	{
+		Phase phase(generating, options);
+		program.declare(helper);
+		program.codegen(program, helper);
+	}
+
+	if (exec) {
+		Phase phase(linking, options);
+		result.errors += helper.link();
+	}
+	{
+		Phase phase(optimizing, options);
+		result.errors += helper.passes();
+	}
+
+	if (result.errors) // no output
+		return result;
+
+	if (options.stage == RUN) {
+		report(options, err); // the program might not return
+
+		result.status = helper.run(options.args);
+		return result;
+	}
+
+	Phase phase(emitting, options);
+
+	// Backend partitions (-jN), pass timings are not thread-safe
+	unsigned jobs = options.timing ? 1 : options.jobs;
+
+	if (options.stage == LLVM)
+		out << helper.dump();
+	else if (options.stage == OBJECT and jobs > 1)
+		result.errors += helper.emit(result.objects, jobs); // linked by the caller
+	else {
+		llvm::SmallString<0> buffer;
+		llvm::raw_svector_ostream os(buffer);
+
+		result.errors += helper.emit(os, options.stage == ASSEMBLY);
+
+		if (result.errors == 0)
+			out.write(buffer.data(), buffer.size());
+	}
+
+	return result;
+}
+
+Result compile(const vector<Source>& sources, const Options& options, ostream& out, ostream& err) {
+	// The LLVM pass timings are switched process-wide, restored once reported
+	bool timepasses = llvm::TimePassesIsEnabled;
+	llvm::TimePassesIsEnabled = options.timing;
+
+	if (not options.trace.empty())
+		llvm::timeTraceProfilerInitialize();
+
+	Result result = pipeline(sources, options, out, err);
+
+	report(options, err);
+
+	llvm::TimePassesIsEnabled = timepasses;
+
+	return result;
+}
+
+Result compile(const string& source, const Options& options, ostream& out, ostream& err) {
+	return compile(vector<Source>({{options.filename, source}}), options, out, err);
+}
+
+Result compile(const string& source, const Options& options) {
+	ostringstream out, err;
+
+	Result result = compile(source, options, out, err);
+
+	result.output = out.str();
+	result.diagnostics = err.str();
+
+	return result;
+}
+
+}
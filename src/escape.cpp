@@ -0,0 +1,166 @@
+#include "escape.hpp"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+using namespace std;
+
+/// Largest object allocated on the stack, in bytes
+static const uint64_t MAX_SIZE = 256;
+
+/*
+ * State whether an allocated pointer escapes its function.
+ *
+ * @remark The derived pointers (casts and field addresses) are followed.
+ */
+static bool escapes(llvm::Instruction* alloc) {
+	llvm::SmallVector<llvm::Value*, 8> worklist = {alloc};
+	llvm::SmallPtrSet<llvm::Value*, 8> visited = {alloc};
+
+	while (not worklist.empty()) {
+		llvm::Value* ptr = worklist.pop_back_val();
+
+		for (llvm::Use& use: ptr->uses()) {
+			auto* user = llvm::dyn_cast<llvm::Instruction>(use.getUser());
+
+			if (not user)
+				return true;
+
+			switch (user->getOpcode()) {
+				case llvm::Instruction::BitCast:
+				case llvm::Instruction::GetElementPtr:
+					if (visited.insert(user).second)
+						worklist.push_back(user);
+					break;
+				case llvm::Instruction::Load:
+				case llvm::Instruction::ICmp:
+					break;
+				case llvm::Instruction::Store:
+					if (use.getOperandNo() == 0) // stored pointer, not address
+						return true;
+					break;
+				case llvm::Instruction::Call:
+				case llvm::Instruction::Invoke: {
+					auto* call = llvm::cast<llvm::CallBase>(user);
+
+					if (not call->isArgOperand(&use) or not call->doesNotCapture(call->getArgOperandNo(&use)))
+						return true;
+					break;
+				}
+				default: // ret, phi, select, ptrtoint, etc.
+					return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+namespace {
+	/// Replace the non-escaping allocations of a function by allocas
+	struct StackAllocation: public llvm::FunctionPass {
+		static char ID;
+
+		StackAllocation(): llvm::FunctionPass(ID) {}
+
+		llvm::StringRef getPassName() const override {
+			return "VSOP stack allocation";
+		}
+
+		void getAnalysisUsage(llvm::AnalysisUsage& au) const override {
+			au.setPreservesCFG();
+		}
+
+		bool runOnFunction(llvm::Function& f) override {
+			vector<llvm::CallInst*> allocs;
+
+			for (llvm::BasicBlock& bb: f)
+				for (llvm::Instruction& inst: bb)
+					if (auto* call = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+						llvm::Function* callee = call->getCalledFunction();
+
+						if (not callee or (callee->getName() != "bump_alloc" and callee->getName() != "malloc") or call->arg_size() != 1)
+							continue;
+
+						auto* size = llvm::dyn_cast<llvm::ConstantInt>(call->getArgOperand(0));
+
+						if (size and size->getZExtValue() <= MAX_SIZE and not escapes(call))
+							allocs.push_back(call);
+					}
+
+			if (allocs.empty())
+				return false;
+
+			// In the entry block, such that they are static allocas
+			llvm::IRBuilder<> builder(&f.getEntryBlock(), f.getEntryBlock().getFirstInsertionPt());
+
+			for (llvm::CallInst* call: allocs) {
+				uint64_t size = llvm::cast<llvm::ConstantInt>(call->getArgOperand(0))->getZExtValue();
+
+				llvm::AllocaInst* slot = builder.CreateAlloca(
+					llvm::ArrayType::get(builder.getInt8Ty(), size),
+					nullptr,
+					"stack"
+				);
+				slot->setAlignment(16); // as malloc
+
+				call->replaceAllUsesWith(builder.CreatePointerCast(slot, call->getType()));
+				call->eraseFromParent();
+			}
+
+			return true;
+		}
+	};
+}
+
+namespace {
+	/// Inline the fast path of the allocations
+	struct AllocationInlining: public llvm::ModulePass {
+		static char ID;
+
+		AllocationInlining(): llvm::ModulePass(ID) {}
+
+		llvm::StringRef getPassName() const override {
+			return "VSOP allocation inlining";
+		}
+
+		bool runOnModule(llvm::Module& m) override {
+			llvm::Function* alloc = m.getFunction("bump_alloc");
+
+			if (not alloc or alloc->isDeclaration()) // runtime in another module
+				return false;
+
+			vector<llvm::CallInst*> calls;
+
+			for (llvm::User* user: alloc->users())
+				if (auto* call = llvm::dyn_cast<llvm::CallInst>(user))
+					if (call->getCalledFunction() == alloc)
+						calls.push_back(call);
+
+			for (llvm::CallInst* call: calls) {
+				llvm::InlineFunctionInfo info;
+				llvm::InlineFunction(call, info);
+			}
+
+			return not calls.empty();
+		}
+	};
+}
+
+char StackAllocation::ID = 0;
+char AllocationInlining::ID = 0;
+
+llvm::FunctionPass* createStackAllocationPass() {
+	return new StackAllocation();
+}
+
+llvm::ModulePass* createAllocationInliningPass() {
+	return new AllocationInlining();
+}
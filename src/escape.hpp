@@ -0,0 +1,35 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include "llvm/Pass.h"
+
+/**
+ * Stack allocation of non-escaping objects
+ *
+ * An object allocated by 'bump_alloc' or 'malloc' (i.e. by an inlined
+ * '<class>__new') escapes its function if its pointer, or a pointer derived
+ * from it, is stored, returned, converted into an integer, merged with another
+ * pointer (phi or select) or given to a call that may capture it. Other
+ * objects only live as long as the call of the function, such that they are
+ * allocated on its stack frame instead, then scalar-replaced by SROA where
+ * possible.
+ *
+ * @note Calls are interprocedural where the callee is known: its arguments are
+ * marked 'nocapture' by the function attributes inference, which runs on the
+ * callees before the callers.
+ * @remark A pointer which is not merged cannot outlive an iteration of a loop,
+ * such that an allocation in a loop reuses a single slot of the frame.
+ */
+llvm::FunctionPass* createStackAllocationPass();
+
+/**
+ * Inlining of the allocations
+ *
+ * The fast path of 'bump_alloc' (see the runtime) is not inlined by the standard
+ * inliner, such that the allocations remain calls for the escape analysis.
+ * Afterwards, it is inlined into the remaining callers, mostly '<class>__new'
+ * or their own callers, where the size is a constant.
+ */
+llvm::ModulePass* createAllocationInliningPass();
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef LLVM_H
 #define LLVM_H
 
+#include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "llvm/IR/BasicBlock.h"
@@ -16,16 +17,51 @@
 
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
-#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Scalar.h"
-#include "llvm/Transforms/Scalar/GVN.h"
-
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+#include "escape.hpp"
+#include "symbol.hpp"
+
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 #include <memory>
 
+/// Object runtime bitcode (see runtime.cpp)
+extern const unsigned char runtime_bc[];
+extern const size_t runtime_bc_size;
+
 static bool isUnit(llvm::Type* t) {
 	return (not t) or t->isVoidTy();
 }
@@ -89,6 +125,7 @@ static std::string asString(llvm::Type* type) {
 struct Position {
 	int line;
 	int column;
+	int file = 0; // index of the source, for multi-file programs
 };
 
 /// Error wrapper
@@ -100,33 +137,46 @@ struct Error {
 /**
  * LLVM C++ context, builder and module wrapper
  *
- * @note LLVMHelper includes a named values manager and a function pass manager
+ * @note LLVMHelper includes a named values manager and an optimization pipeline
  */
 class LLVMHelper {
 	public:
 		LLVMHelper(const std::string& name) {
-			context = std::make_shared<llvm::LLVMContext>();
+			context = llvm::make_unique<llvm::LLVMContext>();
 			builder = std::make_shared<llvm::IRBuilder<>>(*context);
-			module = std::make_shared<llvm::Module>(name, *context);
+			module = llvm::make_unique<llvm::Module>(name, *context);
 		}
 
-		std::shared_ptr<llvm::LLVMContext> context;
+		/// Context and module are uniquely owned, such that they can be handed over (e.g. to the JIT)
+		std::unique_ptr<llvm::LLVMContext> context;
 		std::shared_ptr<llvm::IRBuilder<>> builder;
-		std::shared_ptr<llvm::Module> module;
+		std::unique_ptr<llvm::Module> module;
 
-		/// Stack of errorsw
-		std::vector<Error> errors;
+		/// Target machine, if any
+		std::shared_ptr<llvm::TargetMachine> machine;
+
+		/// Diagnostics output (validation, target, emission, etc.)
+		std::ostream* err = &std::cerr;
 
 		/// Stack of innermost loop-exits
 		std::vector<llvm::BasicBlock*> exits;
 
+		/// Output of the field access counts, if instrumented (-field-layout-instrument)
+		std::string instrument;
+
+		/// Garbage collected heap (-gc), see the collector in resources/runtime/object.ll
+		bool gc = false;
+
+		/// Roots of the garbage collector in the current function, laid out by frame
+		std::vector<llvm::AllocaInst*> roots;
+
 		/**
 		 * Insert a named value
 		 *
 		 * @warning push does not allocate memory
 		 * @see alloc
 		 */
-		llvm::Value* push(const std::string& name, llvm::Value* ptr) {
+		llvm::Value* push(Symbol name, llvm::Value* ptr) {
 			if (this->contains(name))
 				scope.at(name).push_back(ptr);
 			else
@@ -136,7 +186,7 @@ class LLVMHelper {
 		}
 
 		/// Remove a named value
-		llvm::Value* pop(const std::string& name) {
+		llvm::Value* pop(Symbol name) {
 			llvm::Value* ptr = nullptr;
 
 			if (this->contains(name)) {
@@ -152,35 +202,116 @@ class LLVMHelper {
 		}
 
 		/// Get a named value
-		llvm::Value* getValue(const std::string& name) const {
+		llvm::Value* getValue(Symbol name) const {
 			if (this->contains(name))
 				return scope.at(name).back();
 			return nullptr;
 		}
 
 		/// Get a named value type
-		llvm::Type* getType(const std::string& name) const {
+		llvm::Type* getType(Symbol name) const {
 			if (llvm::Value* ptr = this->getValue(name))
 				return ptr->getType()->getPointerElementType();
 			return nullptr;
 		}
 
 		/// State whether a name is associated to a value
-		bool contains(const std::string& name) const {
+		bool contains(Symbol name) const {
 			return scope.find(name) != scope.end();
 		}
 
 		/**
-		 * Allocate named memory on the stack
+		 * Allocate named memory on the stack, in the entry block of the current function
+		 *
+		 * The memory is initialized by the caller, at the current insertion point. As all allocations lie in the entry
+		 * block, they are promoted to registers (mem2reg) and a variable declared in a loop does not grow the stack.
 		 *
 		 * @note It is not possible to allocate/store a 'void' ('unit') type per-say. Instead a nullptr is inserted.
 		 * @see push
 		 */
-		llvm::Value* alloc(const std::string& name, llvm::Type* type) {
-			return this->push(
-				name,
-				isUnit(type) ? nullptr : builder->CreateAlloca(type)
-			);
+		llvm::Value* alloc(Symbol name, llvm::Type* type) {
+			if (gc and type->isPointerTy()) // object or string
+				return this->push(name, this->root(type));
+
+			if (isUnit(type))
+				return this->push(name, nullptr);
+
+			llvm::BasicBlock& entry = builder->GetInsertBlock()->getParent()->getEntryBlock();
+			llvm::IRBuilder<> at(&entry, entry.begin());
+
+			return this->push(name, at.CreateAlloca(type));
+		}
+
+		/**
+		 * Allocate a root of the garbage collector, in the entry block of the current function
+		 *
+		 * @warning The roots are only visible to the collector once the function is complete, see frame.
+		 */
+		llvm::AllocaInst* root(llvm::Type* type) {
+			llvm::BasicBlock& entry = builder->GetInsertBlock()->getParent()->getEntryBlock();
+			llvm::IRBuilder<> at(&entry, entry.begin());
+
+			roots.push_back(at.CreateAlloca(type));
+
+			return roots.back();
+		}
+
+		/**
+		 * Keep a value alive until the current function returns, or the value is overwritten (e.g. in a loop)
+		 *
+		 * @return the value
+		 * @note Constants (string literals) and arguments, kept alive by the caller, are not rooted.
+		 */
+		llvm::Value* retain(llvm::Value* value) {
+			if (gc and value and value->getType()->isPointerTy() and not llvm::isa<llvm::Constant>(value) and not llvm::isa<llvm::Argument>(value))
+				builder->CreateStore(value, this->root(value->getType()));
+
+			return value;
+		}
+
+		/**
+		 * Lay out the roots of a complete function into a frame of the shadow stack
+		 *
+		 * The frame, i.e. '{ i8* next, i64 count, [count x i8*] roots }', is zeroed and pushed on 'gc_frames' at the
+		 * entry of the function, and popped before each return.
+		 *
+		 * @note A function without roots has no frame.
+		 */
+		void frame(llvm::Function* f) {
+			if (roots.empty())
+				return;
+
+			llvm::Type* ptr_t = llvm::Type::getInt8PtrTy(*context);
+			llvm::Type* roots_t = llvm::ArrayType::get(ptr_t, roots.size());
+			llvm::StructType* frame_t = llvm::StructType::get(*context, {ptr_t, llvm::Type::getInt64Ty(*context), roots_t});
+
+			llvm::Value* head = module->getOrInsertGlobal("gc_frames", ptr_t);
+
+			llvm::BasicBlock& entry = f->getEntryBlock();
+			llvm::IRBuilder<> at(&entry, entry.begin());
+
+			llvm::Value* frame = at.CreateAlloca(frame_t, nullptr, "frame");
+
+			for (size_t i = 0; i < roots.size(); ++i)
+				roots[i]->replaceAllUsesWith(at.CreatePointerCast(at.CreateConstGEP2_32(roots_t, at.CreateStructGEP(frame_t, frame, 2), 0, i), roots[i]->getType()));
+
+			// Push
+			at.CreateStore(llvm::Constant::getNullValue(roots_t), at.CreateStructGEP(frame_t, frame, 2));
+			at.CreateStore(at.getInt64(roots.size()), at.CreateStructGEP(frame_t, frame, 1));
+			at.CreateStore(at.CreateLoad(ptr_t, head), at.CreateStructGEP(frame_t, frame, 0));
+			at.CreateStore(at.CreatePointerCast(frame, ptr_t), head);
+
+			// Pop
+			for (llvm::BasicBlock& bb: *f)
+				if (llvm::isa_and_nonnull<llvm::ReturnInst>(bb.getTerminator())) {
+					at.SetInsertPoint(bb.getTerminator());
+					at.CreateStore(at.CreateLoad(ptr_t, at.CreateStructGEP(frame_t, frame, 0)), head);
+				}
+
+			for (llvm::AllocaInst* root: roots)
+				root->eraseFromParent();
+
+			roots.clear();
 		}
 
 		/**
@@ -190,7 +321,7 @@ class LLVMHelper {
 		 * @warning should be preceeded by alloc
 		 * @see alloc
 		 */
-		llvm::Value* store(const std::string& name, llvm::Value* value) const {
+		llvm::Value* store(Symbol name, llvm::Value* value) const {
 			if (llvm::Value* ptr = this->getValue(name))
 				return builder->CreateStore(value, ptr)->getOperand(0);
 			return nullptr;
@@ -202,7 +333,7 @@ class LLVMHelper {
 		 * @warning should be preceeded by store
 		 * @see store
 		 */
-		llvm::Value* load(const std::string& name) const {
+		llvm::Value* load(Symbol name) const {
 			if (llvm::Value* ptr = this->getValue(name))
 				return builder->CreateLoad(ptr);
 			return nullptr;
@@ -220,12 +351,59 @@ class LLVMHelper {
 			return st ? st->getPointerTo() : nullptr;
 		}
 
+		/**
+		 * Record the class of a global value (vtable, constructor, method, etc.), such that the backend partitions keep
+		 * the class whole (see emit)
+		 *
+		 * @note The class is attached as metadata rather than deduced from the name, as class names may contain '_'.
+		 */
+		void owner(llvm::GlobalObject* go, const std::string& c) {
+			go->setMetadata("vsop.class", llvm::MDNode::get(*context, llvm::MDString::get(*context, c)));
+		}
+
+		/**
+		 * String literal, from the constant pool of the module
+		 *
+		 * A string points to its characters, null-terminated, preceded by its length and hash (64-bit FNV-1a), i.e.
+		 * '{ i64 length, i64 hash, [length + 1 x i8] chars }', such that C functions take it as is.
+		 *
+		 * @note Identical literals share a single constant.
+		 * @see the string functions of the runtime
+		 */
+		llvm::Constant* literal(const std::string& str) {
+			llvm::Constant*& chars = literals[str];
+
+			if (chars)
+				return chars;
+
+			uint64_t hash = 14695981039346656037ULL;
+
+			for (unsigned char c: str) {
+				hash ^= c;
+				hash *= 1099511628211ULL;
+			}
+
+			llvm::Constant* init = llvm::ConstantStruct::getAnon({
+				builder->getInt64(str.size()),
+				builder->getInt64(hash),
+				llvm::ConstantDataArray::getString(*context, str)
+			});
+
+			auto* global = new llvm::GlobalVariable(*module, init->getType(), true, llvm::GlobalValue::PrivateLinkage, init, "str");
+			global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+			llvm::Constant* indices[] = {builder->getInt64(0), builder->getInt32(2), builder->getInt64(0)};
+			chars = llvm::ConstantExpr::getInBoundsGetElementPtr(init->getType(), global, indices);
+
+			return chars;
+		}
+
 		/// Default value of a type
 		llvm::Value* defaultValue(llvm::Type* type) {
 			if (isClass(type))
 				return llvm::ConstantPointerNull::get((llvm::PointerType*) type);
 			else if (isString(type))
-				return builder->CreateGlobalStringPtr("", "str");
+				return this->literal("");
 			else if (isPrimitive(type))
 				return llvm::Constant::getNullValue(type);
 
@@ -253,41 +431,447 @@ class LLVMHelper {
 			return nullptr;
 		}
 
-		/// Optimize module functions
-		int passes() {
-			// Create function pass manager
-			llvm::legacy::FunctionPassManager optimizer(module.get());
-
-			optimizer.add(llvm::createInstructionCombiningPass()); // peephole and bit-twiddling optimizations
-			optimizer.add(llvm::createReassociatePass()); // reassociate expressions
-			optimizer.add(llvm::createGVNPass()); // eliminate common sub-expressions
-			optimizer.add(llvm::createCFGSimplificationPass()); // simplify the control flow graph (deleting unreachable blocks, etc)
-
-			optimizer.doInitialization();
+		/**
+		 * Optimization level
+		 *
+		 * @note The speed level ranges from 0 (-O0) to 3 (-O3), the size level from 0 to 2 (-Os is 1).
+		 */
+		unsigned speed_level = 2, size_level = 0;
 
+		/**
+		 * Validate and optimize the module
+		 *
+		 * @note At -O0 the module is only validated.
+		 */
+		int passes() {
 			int errs = 0;
 
 			// Error output
 			std::string str;
 			llvm::raw_string_ostream rso(str);
 
-			// Pass over each functions
-			for (auto it = module->begin(); it != module->end(); ++it) {
-				// Validate the generated code
+			// Validate the generated code
+			for (auto it = module->begin(); it != module->end(); ++it)
 				if (llvm::verifyFunction(*it, &rso)) {
 					rso << '\n';
 					++errs;
-					continue;
 				}
 
-				// Run the optimizer
-				optimizer.run(*it);
+			if (errs) {
+				*err << rso.str();
+				return errs;
+			}
+
+			if (speed_level == 0 and size_level == 0) // -O0
+				return 0;
+
+			// Standard module pipeline (mem2reg, SROA, inlining, IPO, loops, etc.)
+			llvm::PassManagerBuilder builder;
+
+			builder.OptLevel = speed_level;
+			builder.SizeLevel = size_level;
+			builder.Inliner = llvm::createFunctionInliningPass(speed_level, size_level, false);
+			builder.LoopVectorize = speed_level > 1 and size_level < 2;
+			builder.SLPVectorize = speed_level > 1 and size_level < 2;
+
+			// Non-escaping objects on the stack, once inlined, then into registers (see escape.hpp)
+			builder.addExtension(
+				llvm::PassManagerBuilder::EP_ScalarOptimizerLate,
+				[](const llvm::PassManagerBuilder&, llvm::legacy::PassManagerBase& pm) {
+					pm.add(createStackAllocationPass());
+					pm.add(llvm::createSROAPass());
+				}
+			);
+
+			// Then, fast path of the remaining ones
+			builder.addExtension(
+				llvm::PassManagerBuilder::EP_OptimizerLast,
+				[](const llvm::PassManagerBuilder&, llvm::legacy::PassManagerBase& pm) {
+					pm.add(createAllocationInliningPass());
+				}
+			);
+
+			llvm::legacy::FunctionPassManager function_passes(module.get());
+			llvm::legacy::PassManager module_passes;
+
+			// Whole program, only the entry point is visible from the outside
+			if (linked)
+				module_passes.add(llvm::createInternalizePass(
+					[](const llvm::GlobalValue& gv) { return gv.getName() == "main"; }
+				));
+
+			if (machine) {
+				machine->adjustPassManager(builder);
+
+				function_passes.add(llvm::createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis()));
+				module_passes.add(llvm::createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis()));
 			}
 
-			if (errs)
-				std::cerr << rso.str();
+			builder.populateFunctionPassManager(function_passes);
+			builder.populateModulePassManager(module_passes);
+
+			// Pass over each functions
+			function_passes.doInitialization();
+
+			for (auto it = module->begin(); it != module->end(); ++it)
+				function_passes.run(*it);
+
+			function_passes.doFinalization();
+
+			// Pass over the whole module
+			module_passes.run(*module);
 
-			return errs;
+			return 0;
+		}
+
+		/**
+		 * Select the target machine of the module
+		 *
+		 * @param arch target architecture, host's if empty or "native"
+		 * @param cpu target processor, host's (along with its features) if "native"
+		 * @note -march=native implies -mcpu=native, unless a processor is given.
+		 */
+		bool target(std::string arch="", std::string cpu="") {
+			LLVMHelper::initialize();
+
+			if (arch == "native") {
+				arch.clear();
+
+				if (cpu.empty())
+					cpu = "native";
+			}
+
+			llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+			std::string error;
+
+			const llvm::Target* t = llvm::TargetRegistry::lookupTarget(arch, triple, error);
+
+			if (not t) {
+				*err << "vsopc: error: " << error << std::endl;
+				return false;
+			}
+
+			// Host processor features
+			llvm::SubtargetFeatures features;
+
+			if (cpu == "native") {
+				cpu = llvm::sys::getHostCPUName().str();
+
+				llvm::StringMap<bool> host;
+				if (llvm::sys::getHostCPUFeatures(host))
+					for (auto& it: host)
+						features.AddFeature(it.first(), it.second);
+			}
+
+			// Target machines are reused by later compilations of the process (e.g. -server)
+			std::string key = triple.getTriple() + ' ' + cpu + ' ' + features.getString() + ' ' + std::to_string(this->codegenLevel());
+			std::shared_ptr<llvm::TargetMachine>& cached = LLVMHelper::machines()[key];
+
+			if (not cached)
+				cached.reset(t->createTargetMachine(
+					triple.getTriple(),
+					cpu,
+					features.getString(),
+					llvm::TargetOptions(),
+					llvm::Reloc::PIC_, // position independent executables
+					llvm::None,
+					this->codegenLevel()
+				));
+
+			if (not cached) {
+				*err << "vsopc: error: unable to create target machine for '" << triple.getTriple() << "'" << std::endl;
+				return false;
+			}
+
+			machine = cached;
+
+			module->setTargetTriple(triple.getTriple());
+			module->setDataLayout(machine->createDataLayout());
+
+			return true;
+		}
+
+		/**
+		 * Register the targets
+		 *
+		 * @note Only the first call has an effect.
+		 */
+		static void initialize() {
+			static bool initialized = []() { // thread-safe initialization
+				llvm::InitializeAllTargetInfos();
+				llvm::InitializeAllTargets();
+				llvm::InitializeAllTargetMCs();
+				llvm::InitializeAllAsmPrinters();
+
+				return true;
+			}();
+
+			(void) initialized;
+		}
+
+		/**
+		 * Emit the module as native object or assembly code
+		 *
+		 * @warning should be preceeded by target
+		 * @see target
+		 */
+		int emit(llvm::raw_pwrite_stream& out, bool assembly=false) {
+			llvm::legacy::PassManager emitter;
+
+			auto type = assembly ? llvm::TargetMachine::CGFT_AssemblyFile : llvm::TargetMachine::CGFT_ObjectFile;
+
+			if (machine->addPassesToEmitFile(emitter, out, nullptr, type)) {
+				*err << "vsopc: error: target cannot emit a file of this type" << std::endl;
+				return 1;
+			}
+
+			emitter.run(*module);
+			out.flush();
+
+			return 0;
+		}
+
+		/**
+		 * Emit the module as several native objects, concurrently (-jN)
+		 *
+		 * The module is split into (at most) n partitions. Each class (its vtable, __new, __init and methods) and
+		 * each function is kept whole in a partition, the largest first into the lightest partition. Each partition
+		 * is then emitted by its own thread, in its own context and with its own target machine.
+		 *
+		 * @param objects object code of each partition, to be linked together
+		 * @note Local symbols are made external, but hidden, such that the partitions can refer to each other. They
+		 * are renamed into a namespace of the module (a hash of its content), such that they do not clash with the
+		 * ones of another module (e.g. with -c). This is safe as nothing outside the module refers to them by name.
+		 * @warning should be preceeded by target
+		 * @see emit
+		 */
+		int emit(std::vector<std::string>& objects, unsigned n) {
+			// Group of a global value, its class (see owner) or itself
+			auto group = [](const llvm::GlobalValue& gv) {
+				if (auto* go = llvm::dyn_cast<llvm::GlobalObject>(&gv))
+					if (llvm::MDNode* md = go->getMetadata("vsop.class"))
+						return "class " + llvm::cast<llvm::MDString>(md->getOperand(0))->getString().str();
+
+				return gv.getName().str();
+			};
+
+			// Size of each group, in instructions
+			std::map<std::string, size_t> sizes;
+
+			for (llvm::GlobalValue& gv: module->global_values())
+				if (not gv.isDeclaration()) {
+					auto* f = llvm::dyn_cast<llvm::Function>(&gv);
+					sizes[group(gv)] += f ? f->getInstructionCount() + 1 : 1;
+				}
+
+			// Balanced partitions
+			std::vector<std::pair<size_t, std::string>> groups;
+
+			for (auto& it: sizes)
+				groups.push_back({it.second, it.first});
+
+			std::stable_sort(groups.begin(), groups.end(), [](const std::pair<size_t, std::string>& a, const std::pair<size_t, std::string>& b) {
+				return a.first > b.first;
+			});
+
+			n = std::max<size_t>(1, std::min<size_t>(n, groups.size()));
+
+			std::vector<size_t> loads(n, 0);
+			std::unordered_map<std::string, unsigned> partitions;
+
+			for (auto& it: groups) {
+				unsigned k = std::min_element(loads.begin(), loads.end()) - loads.begin();
+
+				partitions[it.second] = k;
+				loads[k] += it.first;
+			}
+
+			// Partition of each global value, before the renaming
+			std::unordered_map<const llvm::GlobalValue*, unsigned> partition;
+
+			for (llvm::GlobalValue& gv: module->global_values())
+				if (not gv.isDeclaration())
+					partition[&gv] = partitions.at(group(gv));
+
+			// Namespace of the module
+			llvm::MD5 md5;
+			llvm::MD5::MD5Result digest;
+			llvm::SmallString<0> whole;
+
+			{
+				llvm::raw_svector_ostream os(whole);
+				llvm::WriteBitcodeToFile(*module, os);
+			}
+
+			md5.update(module->getSourceFileName());
+			md5.update(whole);
+			md5.final(digest);
+
+			std::string prefix = "vsop." + digest.digest().substr(0, 16).str() + ".";
+
+			// Partitions refer to each other's symbols
+			for (llvm::GlobalValue& gv: module->global_values())
+				if (gv.hasLocalLinkage()) {
+					gv.setName(prefix + (gv.hasName() ? gv.getName().str() : "anon"));
+					gv.setLinkage(llvm::GlobalValue::ExternalLinkage);
+					gv.setVisibility(llvm::GlobalValue::HiddenVisibility);
+				}
+
+			// Bitcode of each partition, as contexts are not thread-safe
+			std::vector<llvm::SmallString<0>> bitcodes(n);
+
+			for (unsigned k = 0; k < n; ++k) {
+				llvm::ValueToValueMapTy map;
+
+				std::unique_ptr<llvm::Module> part = llvm::CloneModule(*module, map, [&](const llvm::GlobalValue* gv) {
+					auto it = partition.find(gv);
+					return it != partition.end() and it->second == k;
+				});
+
+				llvm::raw_svector_ostream os(bitcodes[k]);
+				llvm::WriteBitcodeToFile(*part, os);
+			}
+
+			// Emission, concurrently
+			std::vector<std::string> diagnostics(n);
+			std::vector<int> errs(n, 0);
+			std::vector<std::thread> threads;
+
+			objects.assign(n, "");
+
+			for (unsigned k = 0; k < n; ++k)
+				threads.emplace_back([&, k]() {
+					std::ostringstream err;
+					LLVMHelper part("VSOP");
+
+					part.err = &err;
+
+					auto m = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcodes[k].str(), "partition"), *part.context);
+
+					if (m) {
+						part.module = std::move(*m);
+						part.machine.reset(machine->getTarget().createTargetMachine(
+							machine->getTargetTriple().str(),
+							machine->getTargetCPU(),
+							machine->getTargetFeatureString(),
+							machine->Options,
+							llvm::Reloc::PIC_,
+							llvm::None,
+							this->codegenLevel()
+						));
+
+						llvm::SmallString<0> buffer;
+						llvm::raw_svector_ostream os(buffer);
+
+						errs[k] = part.emit(os);
+						objects[k] = buffer.str().str();
+					} else
+						errs[k] = part.fail(m.takeError());
+
+					diagnostics[k] = err.str();
+				});
+
+			int total = 0;
+
+			for (unsigned k = 0; k < n; ++k) {
+				threads[k].join();
+
+				*err << diagnostics[k];
+				total += errs[k];
+			}
+
+			return total;
+		}
+
+		/**
+		 * Link the Object runtime into the module
+		 *
+		 * @param whole whether the module is then the whole program, such that only 'main' is visible from the outside
+		 * @note Then, the optimizer sees the user code and the runtime and can inline the builtins.
+		 */
+		int link(bool whole=true) {
+			auto object = llvm::parseBitcodeFile(
+				llvm::MemoryBufferRef(
+					llvm::StringRef((const char*) runtime_bc, runtime_bc_size),
+					"object.bc"
+				),
+				*context
+			);
+
+			if (not object)
+				return this->fail(object.takeError());
+
+			(*object)->setDataLayout(module->getDataLayout());
+			(*object)->setTargetTriple(module->getTargetTriple());
+
+			if (llvm::Linker::linkModules(*module, std::move(*object)))
+				return 1;
+
+			// Strings of the runtime (e.g. inputLine) on the garbage collected heap, whether or not a frame is pushed yet
+			if (gc) {
+				llvm::Function* bump = module->getFunction("string_from");
+				llvm::Function* collected = module->getFunction("gc_string_from");
+
+				if (bump and collected)
+					bump->replaceAllUsesWith(collected);
+			}
+
+			linked = whole;
+
+			return 0;
+		}
+
+		/**
+		 * Execute the module in-process
+		 *
+		 * @param args program arguments, starting with the program name
+		 * @return the exit code of the program, or 1 in case of failure
+		 * @warning The module and the context are handed over to the JIT, the helper cannot be used afterwards.
+		 * @see link
+		 */
+		int run(const std::vector<std::string>& args) {
+			auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+
+			if (not jtmb)
+				return this->fail(jtmb.takeError());
+
+			jtmb->setCodeGenOptLevel(this->codegenLevel());
+
+			auto jit = llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(*jtmb)).create();
+
+			if (not jit)
+				return this->fail(jit.takeError());
+
+			const llvm::DataLayout& dl = (*jit)->getDataLayout();
+
+			// Resolve C library symbols (printf, malloc, etc.) in the current process
+			auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(dl);
+
+			if (not process)
+				return this->fail(process.takeError());
+
+			(*jit)->getMainJITDylib().setGenerator(std::move(*process));
+
+			module->setDataLayout(dl);
+
+			if (auto err = (*jit)->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))))
+				return this->fail(std::move(err));
+
+			// Entry point
+			auto main = (*jit)->lookup("main");
+
+			if (not main)
+				return this->fail(main.takeError());
+
+			std::vector<char*> argv;
+
+			for (const std::string& arg: args)
+				argv.push_back(const_cast<char*>(arg.c_str()));
+			argv.push_back(nullptr);
+
+			auto f = (int (*)(int, char**)) main->getAddress();
+
+			return f(args.size(), argv.data());
 		}
 
 		std::string dump() {
@@ -298,12 +882,45 @@ class LLVMHelper {
 		}
 
 	private:
+		/// Backend optimization level
+		llvm::CodeGenOpt::Level codegenLevel() const {
+			switch (speed_level) {
+				case 0: return llvm::CodeGenOpt::None;
+				case 1: return llvm::CodeGenOpt::Less;
+				case 2: return llvm::CodeGenOpt::Default;
+				default: return llvm::CodeGenOpt::Aggressive;
+			}
+		}
+
+		/// Whether the runtime has been linked into the module, which is the whole program
+		bool linked = false;
+
+		/**
+		 * Target machines created so far, by triple, processor, features and level
+		 *
+		 * @note Target machines are not shared between threads.
+		 */
+		static std::unordered_map<std::string, std::shared_ptr<llvm::TargetMachine>>& machines() {
+			static thread_local std::unordered_map<std::string, std::shared_ptr<llvm::TargetMachine>> table;
+			return table;
+		}
+
+		/// Report an LLVM error
+		int fail(llvm::Error e) {
+			llvm::raw_os_ostream os(*err);
+			llvm::logAllUnhandledErrors(std::move(e), os, "vsopc: error: ");
+			return 1;
+		}
+
 		/**
 		 * Storage for named values with O(1) insertion, removal and lookup
 		 *
 		 * @see push, pop, get, getType, contains, alloc, store and load
 		 */
-		std::unordered_map<std::string, std::vector<llvm::Value*>> scope;
+		std::unordered_map<Symbol, std::vector<llvm::Value*>> scope;
+
+		/// Constant pool of the string literals, by value
+		std::unordered_map<std::string, llvm::Constant*> literals;
 };
 
 #endif
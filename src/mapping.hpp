@@ -0,0 +1,111 @@
+#ifndef MAPPING_H
+#define MAPPING_H
+
+#include <cerrno>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Source file mapped in memory
+ *
+ * The mapping is private (copy-on-write) and writable, and the file is
+ * followed by two null characters, such that flex can scan it in place
+ * (yy_scan_buffer) without copying it.
+ *
+ * @note Files which cannot be mapped (pipes, terminals, etc.) are read instead.
+ */
+class Mapping {
+	public:
+		Mapping(const std::string& filename) {
+			int fd = open(filename.c_str(), O_RDONLY);
+
+			if (fd < 0)
+				return;
+
+			struct stat st;
+
+			if (fstat(fd, &st) == 0 and S_ISREG(st.st_mode))
+				this->map(fd, st.st_size);
+
+			if (not base)
+				this->read(fd);
+
+			close(fd);
+		}
+
+		Mapping(const Mapping&) = delete;
+		Mapping& operator=(const Mapping&) = delete;
+
+		~Mapping() {
+			if (length)
+				munmap(base, length);
+		}
+
+		/// Whether the file has been mapped or read
+		explicit operator bool() const {
+			return base != nullptr;
+		}
+
+		/// Content of the file, followed by two null characters
+		char* data() const {
+			return base;
+		}
+
+		/// Size of the file
+		size_t size() const {
+			return n;
+		}
+
+	private:
+		/**
+		 * Map the file over an anonymous region
+		 *
+		 * @remark The region is one page longer than needed at most, such that
+		 * the characters following the file are zeros, even if its size is a
+		 * multiple of the page size.
+		 */
+		void map(int fd, size_t size) {
+			size_t page = sysconf(_SC_PAGESIZE);
+			size_t total = (size + 2 + page - 1) / page * page;
+
+			void* region = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (region == MAP_FAILED)
+				return;
+
+			if (size > 0 and mmap(region, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+				munmap(region, total);
+				return;
+			}
+
+			base = (char*) region;
+			length = total;
+			n = size;
+		}
+
+		/// Read the file into a buffer
+		void read(int fd) {
+			char chunk[1 << 16];
+
+			for (ssize_t r; (r = ::read(fd, chunk, sizeof chunk)) != 0;)
+				if (r > 0)
+					buffer.append(chunk, r);
+				else if (errno != EINTR)
+					return;
+
+			n = buffer.size();
+			buffer.append(2, '\0');
+			base = &buffer[0];
+		}
+
+		char* base = nullptr;
+		size_t length = 0, n = 0;
+
+		std::string buffer;
+};
+
+#endif
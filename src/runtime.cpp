@@ -0,0 +1,13 @@
+#include <cstddef>
+
+/**
+ * Object runtime, as LLVM bitcode
+ *
+ * @note The bitcode is generated from resources/runtime/object.ll at build time.
+ * @see LLVMHelper::link
+ */
+extern const unsigned char runtime_bc[] = {
+	#include "runtime.h"
+};
+
+extern const size_t runtime_bc_size = sizeof(runtime_bc);
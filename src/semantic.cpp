@@ -0,0 +1,673 @@
+#include "semantic.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+/***** Types *****/
+
+bool VType::conformsTo(const VType& t) const {
+	if (this->isClass() and t.isClass())
+		return Class::isSubclassOf(c, t.c);
+
+	return kind == t.kind or (this->isNumeric() and t.isNumeric());
+}
+
+string VType::toString() const {
+	switch (kind) {
+		case INT32: return "int32";
+		case DOUBLE: return "double";
+		case BOOL: return "bool";
+		case STRING: return "string";
+		case CLASS: return c->name;
+		default: return "unit";
+	}
+}
+
+/*
+ * Size, and alignment, of a value of a type in an instance, in bytes.
+ *
+ * @note Pointers are assumed 64-bit, the target being only known by the code generation.
+ */
+static unsigned sizeOf(const VType& t) {
+	switch (t.kind) {
+		case VType::UNIT: return 0;
+		case VType::BOOL: return 1;
+		case VType::INT32: return 4;
+		default: return 8;
+	}
+}
+
+/***** Block *****/
+
+VType Block::_check(Program& p, SemanticHelper& s) {
+	exprs.check(p, s);
+	return exprs.empty() ? VType() : exprs.back()->getType();
+}
+
+/***** Field *****/
+
+VType Field::_check(Program& p, SemanticHelper& s) {
+	if (init) {
+		init->check(p, s);
+
+		if (not init->getType().conformsTo(resolved))
+			s.errors.push_back({init->pos, "expected type '" + type + "', but got initializer of type '" + init->getType().toString() + "'"});
+	}
+
+	return resolved;
+}
+
+/***** Method *****/
+
+void Method::check(Program& p, SemanticHelper& s) {
+	if (not block) // extern method
+		return;
+
+	// Add arguments to scope
+	if (parent)
+		s.push(symbols::self, VType(VType::CLASS, parent));
+
+	for (Formal* formal: formals)
+		s.push(formal->name, formal->resolved);
+
+	// Method block
+	block->check(p, s);
+
+	// Remove arguments from scope
+	if (parent)
+		s.pop(symbols::self);
+
+	for (Formal* formal: formals)
+		s.pop(formal->name);
+
+	// Result type
+	if (not block->getType().conformsTo(resolved))
+		s.errors.push_back({block->pos, "expected type '" + type + "', but got return value of type '" + block->getType().toString() + "'"});
+}
+
+bool Method::declaration(Program& p, SemanticHelper& s) {
+	// Formals
+	for (auto it = formals.begin(); it != formals.end(); ++it) {
+		if (not p.resolve((*it)->type, (*it)->resolved)) { // invalid type
+			s.errors.push_back({(*it)->pos, "unknown type '" + (*it)->type  + "' for formal " + (*it)->name});
+			it = prev(formals.erase(it));
+		} else if (formals_table.find((*it)->name) != formals_table.end()) { // formal already exists
+			s.errors.push_back({(*it)->pos, "redefinition of formal " + (*it)->name + " of method " + this->getName(true)});
+			it = prev(formals.erase(it));
+		} else
+			formals_table[(*it)->name] = *it;
+	}
+
+	if (p.resolve(type, resolved))
+		return true;
+
+	s.errors.push_back({this->pos, "unknown return type '" + type + "' of method " + this->getName(true)});
+
+	return false;
+}
+
+/***** Class *****/
+
+void Class::check(Program& p, SemanticHelper& s) {
+	// Initializers, outside of any method
+	fields.check(p, s);
+
+	methods.check(p, s);
+}
+
+void Class::declaration(Program& p, SemanticHelper& s) {
+	if (declared)
+		return;
+
+	declared = true;
+
+	// Ensure parent is declared
+	if (parent)
+		parent->declaration(p, s);
+
+	// Indices
+	unsigned f_idx = 1, m_idx = 0;
+
+	if (parent) {
+		for (auto& it: parent->fields_table)
+			f_idx = max(f_idx, it.second->idx + 1);
+		for (auto& it: parent->methods_table)
+			m_idx = max(m_idx, it.second->idx + 1);
+	}
+
+	// Fields
+	for (auto it = fields.begin(); it != fields.end(); ++it) {
+		if (not p.resolve((*it)->type, (*it)->resolved)) { // invalid type
+			s.errors.push_back({this->pos, "unknown type '" + (*it)->type + "' for field " + (*it)->name});
+			it = prev(fields.erase(it));
+		} else if (fields_table.find((*it)->name) != fields_table.end()) { // field already exists
+			s.errors.push_back({(*it)->pos, "redefinition of field " + (*it)->name + " of class " + name});
+			it = prev(fields.erase(it));
+		} else if (parent and parent->fields_table.find((*it)->name) != parent->fields_table.end()) { // field already exists in parent
+			s.errors.push_back({(*it)->pos, "overriding field " + (*it)->name + " of class " + name});
+			it = prev(fields.erase(it));
+		} else {
+			fields_table[(*it)->name] = *it;
+			(*it)->parent = this;
+			(*it)->idx = 0; // unit fields are not stored, see below
+		}
+	}
+
+	// Layout, the accessed fields (if profiled) first, then the others
+	vector<Field*> hot, cold;
+
+	for (Field* field: fields)
+		if (not field->resolved.isUnit())
+			(s.accesses.count(name + "." + field->name) ? hot : cold).push_back(field);
+
+	stable_sort(hot.begin(), hot.end(), [&](Field* a, Field* b) {
+		return s.accesses.at(name + "." + a->name) > s.accesses.at(name + "." + b->name);
+	});
+
+	size = parent ? parent->size : size;
+
+	for (vector<Field*>* group: {&hot, &cold})
+		while (not group->empty()) {
+			// The largest field without padding, or else the largest one
+			auto it = min_element(group->begin(), group->end(), [&](Field* a, Field* b) {
+				unsigned sa = sizeOf(a->resolved), sb = sizeOf(b->resolved);
+				bool fa = size % sa == 0, fb = size % sb == 0;
+
+				return fa != fb ? fa : sa > sb;
+			});
+
+			unsigned n = sizeOf((*it)->resolved);
+
+			size = (size + n - 1) / n * n + n;
+			(*it)->idx = f_idx++;
+
+			group->erase(it);
+		}
+
+	if (parent)
+		fields_table.insert(parent->fields_table.begin(), parent->fields_table.end());
+
+	// Methods
+	for (auto it = methods.begin(); it != methods.end(); ++it) {
+		(*it)->parent = this;
+
+		if (methods_table.find((*it)->name) != methods_table.end()) { // method already exists
+			s.errors.push_back({(*it)->pos, "redefinition of method " + (*it)->getName(true)});
+			it = prev(methods.erase(it));
+		} else if (not (*it)->declaration(p, s)) // invalid method
+			it = prev(methods.erase(it));
+		else if (parent and parent->methods_table.find((*it)->name) != parent->methods_table.end()) { // method already exists in parent
+			Method* m = parent->methods_table[(*it)->name];
+
+			int i = 0;
+			if ((*it)->formals.size() == m->formals.size())
+				for (; i < (*it)->formals.size(); ++i)
+					if ((*it)->formals[i]->type != m->formals[i]->type)
+						break;
+
+			if ((*it)->type == m->type and i == (*it)->formals.size()) {
+				methods_table[(*it)->name] = *it;
+				(*it)->idx = m->idx;
+			} else {
+				s.errors.push_back({(*it)->pos, "overriding method " + m->getName(true) + " with different signature"});
+				it = prev(methods.erase(it));
+			}
+		} else {
+			methods_table[(*it)->name] = *it;
+			(*it)->idx = m_idx++;
+		}
+	}
+
+	if (parent)
+		for (auto it = parent->methods_table.begin(); it != parent->methods_table.end(); ++it)
+			if (methods_table.find(it->first) == methods_table.end())
+				methods_table[it->first] = it->second;
+}
+
+/***** Program *****/
+
+void Program::check(Program& p, SemanticHelper& s) {
+	classes.check(p, s);
+	functions.check(p, s);
+
+	// Main
+	this->entry(p, s);
+}
+
+void Program::entry(Program& p, SemanticHelper& s) {
+	if (functions_table.find(symbols::main) != functions_table.end()) {
+		Method* m = functions_table[symbols::main];
+
+		if (m->formals.size() != 0 or m->type != symbols::int32)
+			s.errors.push_back({m->pos, "function " + m->getName(true) + " declared with wrong signature"});
+	} else if (classes_table.find(symbols::Main) != classes_table.end()) {
+		Class* c = classes_table[symbols::Main];
+
+		if (c->methods_table.find(symbols::main) != c->methods_table.end()) {
+			Method* m = c->methods_table[symbols::main];
+
+			if (m->formals.size() == 0 and m->type == symbols::int32) { // main() : int32
+				main = arena.make<Call>(arena.make<New>(symbols::Main), symbols::main, List<Expr>());
+				main->check(p, s);
+			} else
+				s.errors.push_back({m->pos, "method " + m->getName(true) + " declared with wrong signature"});
+		} else
+			s.errors.push_back({c->pos, "undeclared method main in class Main"});
+	} else
+		s.errors.push_back({this->pos, "undeclared class Main"});
+}
+
+void Program::declaration(SemanticHelper& s) {
+	// Object
+	classes_table[symbols::Object] = arena.make<Class>(symbols::Object, symbols::Object, List<Field>(),
+		List<Method>({
+			arena.make<Method>("print", List<Formal>({arena.make<Formal>("s", "string")}), "Object", nullptr),
+			arena.make<Method>("printBool", List<Formal>({arena.make<Formal>("b", "bool")}), "Object", nullptr),
+			arena.make<Method>("printInt32", List<Formal>({arena.make<Formal>("i", "int32")}), "Object", nullptr),
+			arena.make<Method>("inputLine", List<Formal>(), "string", nullptr),
+			arena.make<Method>("inputBool", List<Formal>(), "bool", nullptr),
+			arena.make<Method>("inputInt32", List<Formal>(), "int32", nullptr)
+		})
+	);
+
+	// Classes redefinition and overriding
+	int size;
+	do {
+		size = classes_table.size();
+
+		for (auto it = classes.begin(); it != classes.end(); ++it)
+			if ((*it)->parent) // class has already been processed
+				continue;
+			else if (classes_table.find((*it)->name) != classes_table.end()) { // class already exists
+				s.errors.push_back({(*it)->pos, "redefinition of class " + (*it)->name});
+				it = classes.erase(it);
+			} else if (classes_table.find((*it)->parent_name) != classes_table.end()) { // class parent exists
+				classes_table[(*it)->name] = *it;
+				(*it)->parent = classes_table[(*it)->parent_name];
+			}
+
+	} while (size < classes_table.size());
+
+	for (auto it = classes.begin(); it != classes.end(); ++it)
+		if ((*it)->parent) // class has been processed
+			(*it)->declaration(*this, s);
+		else {
+			s.errors.push_back({(*it)->pos, "class " + (*it)->name + " cannot extend class " + (*it)->parent_name});
+			it = prev(classes.erase(it));
+		}
+
+	// Functions redefinition
+	for (auto it = functions.begin(); it != functions.end(); ++it)
+		if (not (*it)->declaration(*this, s)) // invalid function
+			it = prev(functions.erase(it));
+		else if (functions_table.find((*it)->name) != functions_table.end()) { // function already exists
+			s.errors.push_back({(*it)->pos, "redefinition of function " + (*it)->getName(true)});
+			it = prev(functions.erase(it));
+		} else
+			functions_table[(*it)->name] = *it;
+}
+
+bool Program::resolve(Symbol name, VType& t) const {
+	if (name == symbols::unit) t = VType::UNIT;
+	else if (name == symbols::int32) t = VType::INT32;
+	else if (name == symbols::double_) t = VType::DOUBLE;
+	else if (name == symbols::bool_) t = VType::BOOL;
+	else if (name == symbols::string) t = VType::STRING;
+	else {
+		auto it = classes_table.find(name);
+
+		if (it == classes_table.end())
+			return false;
+
+		t = VType(VType::CLASS, it->second);
+	}
+
+	return true;
+}
+
+/***** If *****/
+
+VType If::_check(Program& p, SemanticHelper& s) {
+	cond->check(p, s);
+
+	if (cond->getType().kind != VType::BOOL)
+		s.errors.push_back({cond->pos, "expected type 'bool', but got condition of type '" + cond->getType().toString() + "'"});
+
+	then->check(p, s);
+	if (els)
+		els->check(p, s);
+
+	// Return type
+	VType then_t = then->getType();
+	VType else_t = els ? els->getType() : VType();
+
+	if (then_t == else_t)
+		return then_t;
+	else if (then_t.isNumeric() and else_t.isNumeric())
+		return VType::DOUBLE;
+	else if (then_t.isClass() and else_t.isClass())
+		return VType(VType::CLASS, Class::commonAncestor(then_t.c, else_t.c));
+	else if (not then_t.isUnit() and not else_t.isUnit())
+		s.errors.push_back({this->pos, "expected agreeing branch types, but got types '" + then_t.toString() + "' and '" + else_t.toString() + "'"});
+
+	return VType();
+}
+
+/***** While *****/
+
+VType While::_check(Program& p, SemanticHelper& s) {
+	++s.loops; // (-ext) break point
+
+	cond->check(p, s);
+
+	if (cond->getType().kind != VType::BOOL)
+		s.errors.push_back({cond->pos, "expected type 'bool', but got condition of type '" + cond->getType().toString() + "'"});
+
+	body->check(p, s); // don't care about the type
+
+	--s.loops;
+
+	return VType();
+}
+
+/***** Break *****/
+
+VType Break::_check(Program& p, SemanticHelper& s) {
+	if (s.loops == 0)
+		s.errors.push_back({this->pos, "'break' instruction not in loop"});
+
+	return VType();
+}
+
+/***** For *****/
+
+VType For::_check(Program& p, SemanticHelper& s) {
+	Arena& arena = p.arena; // desugared nodes
+
+	desugared = arena.make<Lets>(
+		List<Field>({
+			arena.make<Field>(name, "int32", first),
+			arena.make<Field>("_last", "int32", last) // underscore starting identifier for privacy
+		}),
+		arena.make<While>(
+			arena.make<Binary>(Binary::LOWER_EQUAL, arena.make<Identifier>(name), arena.make<Identifier>("_last")),
+			arena.make<Block>(List<Expr>({
+				body,
+				arena.make<Assign>(name, arena.make<Binary>(Binary::PLUS, arena.make<Identifier>(name), arena.make<Integer>(1))),
+			}))
+		)
+	);
+
+	desugared->pos = this->pos;
+	desugared->check(p, s);
+
+	return desugared->getType();
+}
+
+/***** Let *****/
+
+VType Let::_check(Program& p, SemanticHelper& s) {
+	if (p.resolve(type, resolved)) {
+		if (init) {
+			init->check(p, s);
+
+			if (not init->getType().conformsTo(resolved))
+				s.errors.push_back({init->pos, "expected type '" + type + "', but got initializer of type '" + init->getType().toString() + "'"});
+		}
+
+		s.push(name, resolved);
+		scope->check(p, s);
+		s.pop(name);
+	} else {
+		s.errors.push_back({this->pos, "unknown type '" + type + "'"});
+		scope->check(p, s);
+	}
+
+	return scope->getType();
+}
+
+/***** Lets *****/
+
+VType Lets::_check(Program& p, SemanticHelper& s) {
+	Expr* x = scope;
+
+	for (auto it = fields.rbegin(); it != fields.rend(); ++it) {
+		x = p.arena.make<Let>((*it)->name, (*it)->type, (*it)->init, x); // recursive
+		x->pos = (*it)->pos;
+	}
+
+	desugared = x;
+	desugared->check(p, s);
+
+	return desugared->getType();
+}
+
+/***** Assign *****/
+
+VType Assign::_check(Program& p, SemanticHelper& s) {
+	value->check(p, s);
+
+	// Get target type, from scope or self's fields
+	VType target_t;
+	Class* c = s.self();
+
+	if (s.contains(name))
+		target_t = s.getType(name);
+	else if (c and c->fields_table.find(name) != c->fields_table.end()) {
+		field = c->fields_table[name];
+		target_t = field->resolved;
+	} else {
+		s.errors.push_back({this->pos, "assignation to undeclared identifier " + name});
+		return VType();
+	}
+
+	if (not value->getType().conformsTo(target_t)) {
+		s.errors.push_back({value->pos, "expected type '" + target_t.toString() + "', but got r-value of type '" + value->getType().toString() + "'"});
+		return VType();
+	}
+
+	return target_t;
+}
+
+/***** Unary *****/
+
+VType Unary::_check(Program& p, SemanticHelper& s) {
+	value->check(p, s);
+	VType value_t = value->getType();
+
+	VType out;
+	string expected;
+
+	switch (type) {
+		case NOT:
+			if (value_t.kind == VType::BOOL)
+				return value_t;
+
+			out = VType::BOOL;
+			expected = "bool";
+			break;
+		case MINUS:
+			if (value_t.isNumeric())
+				return value_t;
+
+			out = VType::INT32;
+			expected = "int32 or double";
+			break;
+		case ISNULL:
+			if (value_t.isClass())
+				return VType::BOOL;
+
+			out = VType::BOOL;
+			expected = "Object";
+	}
+
+	s.errors.push_back({value->pos, "expected type '" + expected + "', but got operand of type '" + value_t.toString() + "'"});
+
+	return out;
+}
+
+/***** Binary *****/
+
+VType Binary::_check(Program& p, SemanticHelper& s) {
+	switch (type) {
+		case AND:
+			desugared = p.arena.make<If>(left, right, p.arena.make<Boolean>(false));
+			break;
+		case OR:
+			desugared = p.arena.make<If>(left, p.arena.make<Boolean>(true), right);
+			break;
+		case NEQUAL: {
+			Binary* equal = p.arena.make<Binary>(EQUAL, left, right);
+			equal->pos = this->pos;
+
+			desugared = p.arena.make<Unary>(Unary::NOT, equal);
+			break;
+		}
+		default:
+			break;
+	}
+
+	if (desugared) {
+		desugared->pos = this->pos;
+		desugared->check(p, s);
+
+		return desugared->getType();
+	}
+
+	left->check(p, s);
+	right->check(p, s);
+
+	VType left_t = left->getType();
+	VType right_t = right->getType();
+
+	if (type == EQUAL) {
+		if (left_t == right_t or (left_t.isNumeric() and right_t.isNumeric()) or (left_t.isClass() and right_t.isClass()))
+			return VType::BOOL;
+
+		s.errors.push_back({this->pos, "expected agreeing operand types, but got types '" + left_t.toString() + "' and '" + right_t.toString() + "'"});
+
+		return VType::BOOL;
+	}
+
+	bool comparison = type == LOWER or type == LOWER_EQUAL or type == GREATER or type == GREATER_EQUAL;
+
+	if (left_t.kind == VType::INT32 and right_t.kind == VType::INT32)
+		return comparison ? VType::BOOL : VType::INT32;
+	else if (left_t.isNumeric() and right_t.isNumeric())
+		return comparison ? VType::BOOL : VType::DOUBLE;
+
+	s.errors.push_back({this->pos, "expected type 'int32 or double', but got operand of types '" + left_t.toString() + "' and '" + right_t.toString() + "'"});
+
+	return comparison ? VType::BOOL : VType::INT32;
+}
+
+/***** Call *****/
+
+VType Call::_check(Program& p, SemanticHelper& s) {
+	scope->check(p, s);
+	VType scope_t = scope->getType();
+
+	args.check(p, s);
+
+	if (not scope_t.isUnit() and not scope_t.isClass()) {
+		s.errors.push_back({scope->pos, "expected object type, but got scope of type '" + scope_t.toString() + "'"});
+		return VType();
+	}
+
+	if (scope_t.isUnit() and p.functions_table.find(name) != p.functions_table.end()) // top-level function
+		method = p.functions_table[name];
+	else if (Class* obj = scope_t.isClass() ? scope_t.c : s.self()) {
+		auto it = obj->methods_table.find(name);
+
+		if (it != obj->methods_table.end()) { // class method
+			method = it->second;
+			c = obj;
+		}
+	}
+
+	if (not method) {
+		s.errors.push_back({this->pos, "call to undeclared method " + name});
+		return VType();
+	}
+
+	size_t n = method->formals.size();
+
+	// Compare call with signature
+	if (not (args.size() == n or (method->variadic and args.size() > n))) {
+		s.errors.push_back({this->pos, "call to method " + method->getName() + " with wrong number of arguments"});
+		return VType();
+	}
+
+	bool valid = true;
+
+	for (size_t i = 0; i < n; ++i)
+		if (not args[i]->getType().conformsTo(method->formals[i]->resolved)) {
+			s.errors.push_back({args[i]->pos, "expected type '" + method->formals[i]->resolved.toString() + "', but got return value of type '" + args[i]->getType().toString() + "'"});
+			valid = false;
+		}
+
+	return valid ? method->resolved : VType();
+}
+
+/***** New *****/
+
+VType New::_check(Program& p, SemanticHelper& s) {
+	auto it = p.classes_table.find(type);
+
+	if (it == p.classes_table.end()) {
+		s.errors.push_back({this->pos, "new instance of unknown object type '" + type + "'"});
+		return VType();
+	}
+
+	return VType(VType::CLASS, it->second);
+}
+
+/***** Identifier *****/
+
+VType Identifier::_check(Program& p, SemanticHelper& s) {
+	// Scope
+	if (s.contains(id))
+		return s.getType(id);
+
+	// Self's fields
+	Class* c = s.self();
+
+	if (c and c->fields_table.find(id) != c->fields_table.end()) {
+		field = c->fields_table[id];
+		return field->resolved;
+	}
+
+	s.errors.push_back({this->pos, "undeclared identifier " + id});
+
+	return VType();
+}
+
+/***** Self *****/
+
+VType Self::_check(Program& p, SemanticHelper& s) {
+	return s.getType(symbols::self);
+}
+
+/***** Literals *****/
+
+VType Integer::_check(Program& p, SemanticHelper& s) {
+	return VType::INT32;
+}
+
+VType Real::_check(Program& p, SemanticHelper& s) {
+	return VType::DOUBLE;
+}
+
+VType Boolean::_check(Program& p, SemanticHelper& s) {
+	return VType::BOOL;
+}
+
+VType String::_check(Program& p, SemanticHelper& s) {
+	return VType::STRING;
+}
+
+VType Unit::_check(Program& p, SemanticHelper& s) {
+	return VType();
+}
@@ -0,0 +1,70 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include "ast.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Semantic analysis context
+ *
+ * Counterpart of LLVMHelper for the semantic analysis: the named values are
+ * only typed, and no LLVM context nor module is involved. The analysis
+ * annotates each expression with its VSOP type (see Expr::getType) and each
+ * name with its declaration, such that the code generation never checks nor
+ * looks anything up by name.
+ *
+ * @see Node::check
+ */
+class SemanticHelper {
+	public:
+		/// Stack of errors
+		std::vector<Error> errors;
+
+		/// Number of enclosing loops
+		unsigned loops = 0;
+
+		/// Number of accesses to each field, by '<class>.<field>' (-field-layout-profile)
+		std::unordered_map<std::string, uint64_t> accesses;
+
+		/// Insert a named value
+		void push(Symbol name, const VType& t) {
+			scope[name].push_back(t);
+		}
+
+		/// Remove a named value
+		void pop(Symbol name) {
+			auto it = scope.find(name);
+
+			if (it != scope.end()) {
+				it->second.pop_back();
+
+				if (it->second.empty())
+					scope.erase(it);
+			}
+		}
+
+		/// Get a named value type
+		VType getType(Symbol name) const {
+			auto it = scope.find(name);
+			return it != scope.end() ? it->second.back() : VType();
+		}
+
+		/// State whether a name is associated to a value
+		bool contains(Symbol name) const {
+			return scope.find(name) != scope.end();
+		}
+
+		/// Class of 'self', if in a method
+		Class* self() const {
+			return this->contains(symbols::self) ? this->getType(symbols::self).c : nullptr;
+		}
+
+	private:
+		std::unordered_map<Symbol, std::vector<VType>> scope;
+};
+
+#endif
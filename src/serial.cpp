@@ -0,0 +1,361 @@
+#include "serial.hpp"
+
+using namespace std;
+
+/***** Writing *****/
+
+void Block::serialize(ASTWriter& w) const {
+	w.tag(ast::BLOCK, *this);
+	w.list(exprs);
+}
+
+void Field::serialize(ASTWriter& w) const {
+	w.tag(ast::FIELD, *this);
+	w.symbol(name);
+	w.symbol(type);
+	w.node(init);
+}
+
+void Formal::serialize(ASTWriter& w) const {
+	w.tag(ast::FORMAL, *this);
+	w.symbol(name);
+	w.symbol(type);
+}
+
+void Method::serialize(ASTWriter& w) const {
+	w.tag(ast::METHOD, *this);
+	w.symbol(name);
+	w.list(formals);
+	w.symbol(type);
+	w.node(block);
+	w.varint(variadic);
+}
+
+void Class::serialize(ASTWriter& w) const {
+	w.tag(ast::CLASS, *this);
+	w.symbol(name);
+	w.symbol(parent_name);
+	w.list(fields);
+	w.list(methods);
+}
+
+void Program::serialize(ASTWriter& w) const {
+	w.list(classes);
+	w.list(functions);
+}
+
+void If::serialize(ASTWriter& w) const {
+	w.tag(ast::IF, *this);
+	w.node(cond);
+	w.node(then);
+	w.node(els);
+}
+
+void While::serialize(ASTWriter& w) const {
+	w.tag(ast::WHILE, *this);
+	w.node(cond);
+	w.node(body);
+}
+
+void Break::serialize(ASTWriter& w) const {
+	w.tag(ast::BREAK, *this);
+}
+
+void For::serialize(ASTWriter& w) const {
+	w.tag(ast::FOR, *this);
+	w.symbol(name);
+	w.node(first);
+	w.node(last);
+	w.node(body);
+}
+
+void Let::serialize(ASTWriter& w) const {
+	w.tag(ast::LET, *this);
+	w.symbol(name);
+	w.symbol(type);
+	w.node(init);
+	w.node(scope);
+}
+
+void Lets::serialize(ASTWriter& w) const {
+	w.tag(ast::LETS, *this);
+	w.list(fields);
+	w.node(scope);
+}
+
+void Assign::serialize(ASTWriter& w) const {
+	w.tag(ast::ASSIGN, *this);
+	w.symbol(name);
+	w.node(value);
+}
+
+void Unary::serialize(ASTWriter& w) const {
+	w.tag(ast::UNARY, *this);
+	w.varint(type);
+	w.node(value);
+}
+
+void Binary::serialize(ASTWriter& w) const {
+	w.tag(ast::BINARY, *this);
+	w.varint(type);
+	w.node(left);
+	w.node(right);
+}
+
+void Call::serialize(ASTWriter& w) const {
+	w.tag(ast::CALL, *this);
+	w.node(scope);
+	w.symbol(name);
+	w.list(args);
+}
+
+void New::serialize(ASTWriter& w) const {
+	w.tag(ast::NEW, *this);
+	w.symbol(type);
+}
+
+void Identifier::serialize(ASTWriter& w) const {
+	w.tag(ast::IDENTIFIER, *this);
+	w.symbol(id);
+}
+
+void Self::serialize(ASTWriter& w) const {
+	w.tag(ast::SELF, *this);
+}
+
+void Integer::serialize(ASTWriter& w) const {
+	w.tag(ast::INTEGER, *this);
+	w.integer(value);
+}
+
+void Real::serialize(ASTWriter& w) const {
+	w.tag(ast::REAL, *this);
+	w.real(value);
+}
+
+void Boolean::serialize(ASTWriter& w) const {
+	w.tag(ast::BOOLEAN, *this);
+	w.varint(b);
+}
+
+void String::serialize(ASTWriter& w) const {
+	w.tag(ast::STRING, *this);
+	w.string(str);
+}
+
+void Unit::serialize(ASTWriter& w) const {
+	w.tag(ast::UNIT, *this);
+}
+
+/***** Reading *****/
+
+bool ASTReader::program(List<Class>& classes, List<Method>& functions, int file) {
+	this->file = file;
+
+	p += sizeof ast::MAGIC - 1;
+
+	if (p + 2 > end or (unsigned char) *p++ != ast::VERSION)
+		return false;
+
+	ext = *p++ & ast::EXT;
+
+	files.resize(min<size_t>(this->varint(), end - p));
+	for (std::string& f: files)
+		f = this->string();
+
+	List<Class> cs = this->list<Class>(ast::CLASS);
+	List<Method> fs = this->list<Method>(ast::METHOD);
+
+	if (corrupted)
+		return false;
+
+	classes.insert(classes.end(), cs.begin(), cs.end());
+	functions.insert(functions.end(), fs.begin(), fs.end());
+
+	return true;
+}
+
+Node* ASTReader::make(ast::Tag tag) {
+	Position pos;
+	pos.line = this->varint();
+	pos.column = this->varint();
+	this->varint(); // file of the original sources
+	pos.file = file;
+
+	Node* n = nullptr;
+
+	switch (tag) {
+		case ast::CLASS: {
+			Symbol name = this->symbol(), parent = this->symbol();
+			List<Field> fields = this->list<Field>(ast::FIELD);
+			List<Method> methods = this->list<Method>(ast::METHOD);
+
+			n = arena.make<Class>(name, parent, std::move(fields), std::move(methods));
+			break;
+		}
+		case ast::FIELD: {
+			Symbol name = this->symbol(), type = this->symbol();
+			n = arena.make<Field>(name, type, this->expr());
+			break;
+		}
+		case ast::FORMAL: {
+			Symbol name = this->symbol(), type = this->symbol();
+			n = arena.make<Formal>(name, type);
+			break;
+		}
+		case ast::METHOD: {
+			Symbol name = this->symbol();
+			List<Formal> formals = this->list<Formal>(ast::FORMAL);
+			Symbol type = this->symbol();
+			Block* block = this->node<Block>(ast::BLOCK);
+			bool variadic = this->varint();
+
+			n = arena.make<Method>(name, std::move(formals), type, block, variadic);
+			break;
+		}
+		case ast::BLOCK:
+			n = arena.make<Block>(this->list<Expr>(ast::EXPR));
+			break;
+		case ast::IF: {
+			Expr* cond = this->expr();
+			Expr* then = this->expr();
+			n = arena.make<If>(cond, then, this->expr());
+			break;
+		}
+		case ast::WHILE: {
+			Expr* cond = this->expr();
+			n = arena.make<While>(cond, this->expr());
+			break;
+		}
+		case ast::BREAK:
+			n = arena.make<Break>();
+			break;
+		case ast::FOR: {
+			Symbol name = this->symbol();
+			Expr* first = this->expr();
+			Expr* last = this->expr();
+			n = arena.make<For>(name, first, last, this->expr());
+			break;
+		}
+		case ast::LET: {
+			Symbol name = this->symbol(), type = this->symbol();
+			Expr* init = this->expr();
+			n = arena.make<Let>(name, type, init, this->expr());
+			break;
+		}
+		case ast::LETS: {
+			List<Field> fields = this->list<Field>(ast::FIELD);
+			n = arena.make<Lets>(std::move(fields), this->expr());
+			break;
+		}
+		case ast::ASSIGN: {
+			Symbol name = this->symbol();
+			n = arena.make<Assign>(name, this->expr());
+			break;
+		}
+		case ast::UNARY: {
+			Unary::Type type = (Unary::Type) this->varint();
+			n = arena.make<Unary>(type, this->expr());
+			break;
+		}
+		case ast::BINARY: {
+			Binary::Type type = (Binary::Type) this->varint();
+			Expr* left = this->expr();
+			n = arena.make<Binary>(type, left, this->expr());
+			break;
+		}
+		case ast::CALL: {
+			Expr* scope = this->expr();
+			Symbol name = this->symbol();
+			n = arena.make<Call>(scope, name, this->list<Expr>(ast::EXPR));
+			break;
+		}
+		case ast::NEW:
+			n = arena.make<New>(this->symbol());
+			break;
+		case ast::IDENTIFIER:
+			n = arena.make<Identifier>(this->symbol());
+			break;
+		case ast::SELF:
+			n = arena.make<Self>();
+			break;
+		case ast::INTEGER:
+			n = arena.make<Integer>(this->integer());
+			break;
+		case ast::REAL:
+			n = arena.make<Real>(this->real());
+			break;
+		case ast::BOOLEAN:
+			n = arena.make<Boolean>(this->varint());
+			break;
+		case ast::STRING:
+			n = arena.make<String>(this->string());
+			break;
+		case ast::UNIT:
+			n = arena.make<Unit>();
+			break;
+		default:
+			corrupted = true;
+			return nullptr;
+	}
+
+	n->pos = pos;
+
+	return n;
+}
+
+Symbol ASTReader::symbol() {
+	size_t ref = this->varint();
+
+	if (ref < symbols.size())
+		return symbols[ref];
+
+	if (ref == symbols.size() and not corrupted) {
+		symbols.push_back(this->string());
+		return symbols.back();
+	}
+
+	corrupted = true;
+	return Symbol("");
+}
+
+string ASTReader::string() {
+	size_t size = this->varint();
+
+	if (size > size_t(end - p)) {
+		corrupted = true;
+		return "";
+	}
+
+	std::string str(p, size);
+	p += size;
+
+	return str;
+}
+
+uint64_t ASTReader::varint() {
+	uint64_t n = 0;
+
+	for (int shift = 0; p < end and shift < 64; shift += 7) {
+		unsigned char b = *p++;
+		n |= (uint64_t) (b & 0x7f) << shift;
+
+		if (not (b & 0x80))
+			return n;
+	}
+
+	corrupted = true; // truncated
+	return 0;
+}
+
+int64_t ASTReader::integer() {
+	uint64_t n = this->varint();
+	return (int64_t) (n >> 1) ^ -(int64_t) (n & 1);
+}
+
+double ASTReader::real() {
+	uint64_t bits = this->varint();
+	double d;
+	std::memcpy(&d, &bits, sizeof d);
+	return d;
+}
@@ -0,0 +1,227 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "ast.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Binary abstract syntax tree (-emit-ast, -load-ast)
+ *
+ *     "VSOPAST" <version:u8> <flags:u8> <files:list<string>> <classes:list<node>> <functions:list<node>>
+ *
+ *     <node> = <NONE> | <tag> <line> <column> <file> <fields>
+ *
+ * Integers are LEB128 varints, lists are prefixed by their size and strings by
+ * their length. Symbols (names and types) refer to a table built along the
+ * tree: a reference equal to the size of the table introduces a new symbol,
+ * followed by its string. The fields of each node are written in the order
+ * of its constructor, child nodes (possibly NONE) and lists of nodes included.
+ *
+ * @note The tree is written as parsed, before the declaration of the program.
+ */
+namespace ast {
+	static const char MAGIC[] = "VSOPAST";
+	static const unsigned char VERSION = 1;
+
+	/// Flags of the tree
+	enum { EXT = 1 };
+
+	/// Kinds of nodes
+	enum Tag {
+		NONE, CLASS, FIELD, FORMAL, METHOD, BLOCK, IF, WHILE, BREAK, FOR, LET, LETS, ASSIGN,
+		UNARY, BINARY, CALL, NEW, IDENTIFIER, SELF, INTEGER, REAL, BOOLEAN, STRING, UNIT,
+		EXPR // any expression (BLOCK to UNIT), never written
+	};
+
+	/// Whether a buffer holds a binary abstract syntax tree
+	static bool is(const char* data, size_t size) {
+		return size >= sizeof MAGIC and std::memcmp(data, MAGIC, sizeof MAGIC - 1) == 0;
+	}
+}
+
+/**
+ * Writer of binary abstract syntax trees
+ *
+ * @see Node::serialize
+ */
+class ASTWriter {
+	public:
+		ASTWriter(std::ostream& out): out(out) {}
+
+		/**
+		 * Write a whole program
+		 *
+		 * @param files names of the sources, indexed by the positions of the nodes
+		 */
+		void program(const Program& p, const std::vector<std::string>& files, bool ext) {
+			buffer.append(ast::MAGIC, sizeof ast::MAGIC - 1);
+			buffer += (char) ast::VERSION;
+			buffer += (char) (ext ? ast::EXT : 0);
+
+			this->varint(files.size());
+			for (const std::string& file: files)
+				this->string(file);
+
+			p.serialize(*this);
+
+			out.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+
+		/// Write the tag and the position of a node
+		void tag(ast::Tag tag, const Node& n) {
+			this->varint(tag);
+			this->varint(n.pos.line);
+			this->varint(n.pos.column);
+			this->varint(n.pos.file);
+		}
+
+		/// Write a node, possibly null
+		void node(const Node* n) {
+			if (n)
+				n->serialize(*this);
+			else
+				this->varint(ast::NONE);
+		}
+
+		template <typename T>
+		void list(const List<T>& l) {
+			this->varint(l.size());
+
+			for (const T* t: l)
+				this->node(t);
+		}
+
+		void symbol(Symbol s) {
+			auto it = symbols.emplace(s.getId(), symbols.size());
+
+			this->varint(it.first->second);
+
+			if (it.second)
+				this->string(s);
+		}
+
+		void string(const std::string& str) {
+			this->varint(str.size());
+			buffer += str;
+		}
+
+		void varint(uint64_t n) {
+			for (; n >= 0x80; n >>= 7)
+				buffer += (char) ((n & 0x7f) | 0x80);
+
+			buffer += (char) n;
+		}
+
+		/// Write a signed integer (zigzag)
+		void integer(int64_t n) {
+			this->varint(((uint64_t) n << 1) ^ (uint64_t) (n >> 63));
+		}
+
+		void real(double d) {
+			uint64_t bits;
+			std::memcpy(&bits, &d, sizeof bits);
+			this->varint(bits);
+		}
+
+	private:
+		std::ostream& out;
+		std::string buffer;
+
+		/// Symbol table
+		std::unordered_map<unsigned, unsigned> symbols;
+};
+
+/**
+ * Reader of binary abstract syntax trees
+ *
+ * The nodes are created in an arena, like parsed ones.
+ */
+class ASTReader {
+	public:
+		ASTReader(const char* data, size_t size, Arena& arena): p(data), end(data + size), arena(arena) {}
+
+		/**
+		 * Read a whole program
+		 *
+		 * @param file index of the source, for the positions of the nodes
+		 * @return false if the tree is corrupted or of another version
+		 */
+		bool program(List<Class>& classes, List<Method>& functions, int file);
+
+		/// Names of the sources of the tree
+		std::vector<std::string> files;
+
+		/// Extended VSOP
+		bool ext = false;
+
+	private:
+		/// Read the fields of a node of a given kind, after its tag
+		Node* make(ast::Tag tag);
+
+		/// Read an expression, possibly null
+		Expr* expr() {
+			return this->node<Expr>(ast::EXPR);
+		}
+
+		/// Read a node of a given kind (any expression if EXPR), possibly null
+		template <typename T>
+		T* node(ast::Tag expected) {
+			ast::Tag tag = (ast::Tag) this->varint();
+
+			if (tag == ast::NONE)
+				return nullptr;
+
+			if (expected == ast::EXPR ? tag < ast::BLOCK or tag > ast::UNIT : tag != expected) {
+				corrupted = true;
+				return nullptr;
+			}
+
+			return static_cast<T*>(this->make(tag));
+		}
+
+		template <typename T>
+		List<T> list(ast::Tag tag) {
+			size_t n = this->varint();
+
+			if (n > size_t(end - p)) // at least one byte per node
+				corrupted = true;
+
+			List<T> l(arena);
+
+			if (not corrupted)
+				l.reserve(n);
+
+			for (size_t i = 0; i < n and not corrupted; ++i)
+				if (T* t = this->node<T>(tag))
+					l.push(t);
+				else
+					corrupted = true;
+
+			return l;
+		}
+
+		Symbol symbol();
+		std::string string();
+		uint64_t varint();
+		int64_t integer();
+		double real();
+
+		const char* p;
+		const char* end;
+		bool corrupted = false;
+
+		Arena& arena;
+		int file = 0;
+
+		/// Symbol table
+		std::vector<Symbol> symbols;
+};
+
+#endif
@@ -0,0 +1,292 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * Compile server and client
+ *
+ * The server keeps LLVM warm (static initialization, registered targets,
+ * target machines) and forks a child per request, such that every compilation
+ * starts from a clean state (fresh LLVMContext, parser, etc.) without paying
+ * for the process startup.
+ *
+ * Over a Unix domain socket, a request is
+ *
+ *     <length:uint32><cwd>\0<arg>\0<arg>\0...
+ *
+ * along with the client's standard file descriptors (SCM_RIGHTS), such that
+ * the outputs go straight to the client. The response is the exit status (int32).
+ */
+
+/// Compilation entry point, as main
+typedef int (*compile_t)(int, char**);
+
+/// Read exactly n bytes
+static bool readall(int fd, void* buffer, size_t n) {
+	for (char* p = (char*) buffer; n > 0;) {
+		ssize_t r = read(fd, p, n);
+
+		if (r <= 0)
+			return false;
+
+		p += r;
+		n -= r;
+	}
+
+	return true;
+}
+
+/// Write exactly n bytes
+static bool writeall(int fd, const void* buffer, size_t n) {
+	for (const char* p = (const char*) buffer; n > 0;) {
+		ssize_t w = write(fd, p, n);
+
+		if (w <= 0)
+			return false;
+
+		p += w;
+		n -= w;
+	}
+
+	return true;
+}
+
+/// Run a compilation with the arguments, behind the program name
+static int call(compile_t compile, const char* argv0, const std::vector<std::string>& args) {
+	std::vector<char*> argv = {const_cast<char*>(argv0)};
+
+	for (const std::string& arg: args)
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	argv.push_back(nullptr);
+
+	int status = compile(argv.size() - 1, argv.data());
+
+	// Flush everything, as the child never exits normally
+	std::cout.flush();
+	std::cerr.flush();
+	fflush(NULL);
+
+	return status;
+}
+
+/// Handle a request from a socket client
+static int handle(int client, compile_t compile, const char* argv0) {
+	uint32_t length;
+	int fds[3];
+
+	// Header and file descriptors
+	char control[CMSG_SPACE(sizeof(fds))];
+	iovec iov = {&length, sizeof(length)};
+
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	if (recvmsg(client, &msg, MSG_WAITALL) != sizeof(length))
+		return 1;
+
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+
+	if (not cmsg or cmsg->cmsg_type != SCM_RIGHTS or cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+		return 1;
+
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+	// Payload
+	std::string payload(length, '\0');
+
+	if (not readall(client, &payload[0], length))
+		return 1;
+
+	std::vector<std::string> args;
+
+	for (size_t i = 0, j; i < payload.size(); i = j + 1) {
+		j = payload.find('\0', i);
+		args.push_back(payload.substr(i, j - i));
+	}
+
+	if (args.empty() or chdir(args.front().c_str()))
+		return 1;
+
+	args.erase(args.begin());
+
+	// Standard file descriptors of the client
+	for (int i = 0; i < 3; ++i) {
+		dup2(fds[i], i);
+		close(fds[i]);
+	}
+
+	int32_t status = call(compile, argv0, args);
+
+	writeall(client, &status, sizeof(status));
+
+	return 0;
+}
+
+/**
+ * Serve compilation requests
+ *
+ * @param path Unix domain socket path, or empty to read requests from the standard input
+ * @remark On the standard input, a request is framed as on the socket,
+ *         <arg>\0<arg>\0...\0 followed by an empty argument (\0), and the
+ *         response is a line 'exit <status>'.
+ */
+static int serve(const std::string& path, compile_t compile, const char* argv0) {
+	if (path.empty()) { // local stand-in
+		for (;;) {
+			std::vector<std::string> args;
+			std::string arg;
+
+			while (std::getline(std::cin, arg, '\0') and not arg.empty())
+				args.push_back(arg);
+
+			if (not std::cin and not arg.empty()) // unterminated at the end of the input
+				args.push_back(arg);
+
+			if (args.empty()) {
+				if (std::cin)
+					continue;
+				break;
+			}
+
+			std::cout.flush();
+			fflush(NULL);
+
+			pid_t pid = fork();
+
+			if (pid == 0) { // child
+				int null = open("/dev/null", O_RDONLY); // requests are on stdin
+				dup2(null, 0);
+				close(null);
+
+				_exit(call(compile, argv0, args));
+			}
+
+			int status = 1;
+
+			if (pid < 0 or waitpid(pid, &status, 0) < 0)
+				status = 1;
+			else
+				status = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+
+			std::cout << "exit " << status << std::endl;
+		}
+
+		return 0;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	unlink(path.c_str());
+
+	if (fd < 0 or bind(fd, (sockaddr*) &addr, sizeof(addr)) or listen(fd, SOMAXCONN)) {
+		std::cerr << "vsopc: error: " << path << ": " << strerror(errno) << std::endl;
+		return 1;
+	}
+
+	signal(SIGCHLD, SIG_IGN); // children are reaped automatically
+
+	for (;;) {
+		int client = accept(fd, nullptr, nullptr);
+
+		if (client < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		pid_t pid = fork();
+
+		if (pid == 0) { // child
+			signal(SIGCHLD, SIG_DFL); // such that system() and waitpid() can wait for the linker, etc.
+			close(fd);
+			_exit(handle(client, compile, argv0));
+		}
+
+		close(client);
+	}
+
+	close(fd);
+	unlink(path.c_str());
+
+	return 1;
+}
+
+/**
+ * Forward a command line to a server
+ *
+ * @return the exit status of the remote compilation
+ */
+static int forward(const std::string& path, const std::vector<std::string>& args) {
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	if (fd < 0 or connect(fd, (sockaddr*) &addr, sizeof(addr))) {
+		std::cerr << "vsopc: error: " << path << ": " << strerror(errno) << std::endl;
+		return 1;
+	}
+
+	// Payload
+	char cwd[4096];
+
+	if (not getcwd(cwd, sizeof(cwd)))
+		return 1;
+
+	std::string payload = cwd;
+
+	for (const std::string& arg: args)
+		payload += '\0' + arg;
+
+	uint32_t length = payload.size();
+
+	// Header and file descriptors
+	int fds[3] = {0, 1, 2};
+
+	char control[CMSG_SPACE(sizeof(fds))] = {};
+	iovec iov = {&length, sizeof(length)};
+
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	int32_t status = 1;
+
+	if (sendmsg(fd, &msg, 0) != sizeof(length) or not writeall(fd, payload.data(), payload.size()) or not readall(fd, &status, sizeof(status)))
+		status = 1;
+
+	close(fd);
+
+	return status;
+}
+
+#endif
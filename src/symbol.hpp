@@ -0,0 +1,152 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Interned string (identifiers, type names, keywords, operators)
+ *
+ * Every distinct string is stored once, for the lifetime of the process, and
+ * a symbol is only its index in the table. Therefore, symbols are compared and
+ * hashed as integers, and copying a symbol never allocates.
+ *
+ * @note Interning is thread-safe, such that sources can be parsed concurrently.
+ * @note The default symbol is the empty string, which is always interned first.
+ * @warning Symbols are not compared to C strings, which would have to be
+ * interned first; compare them to the frequent symbols instead (see ast.hpp).
+ */
+class Symbol {
+	public:
+		Symbol(): _id(0) {}
+		Symbol(const char* data, size_t size): _id(table().intern(data, size)) {}
+		Symbol(const std::string& str): Symbol(str.data(), str.size()) {}
+		Symbol(const char* str): Symbol(str, std::strlen(str)) {}
+
+		/// Index of the symbol in the table
+		unsigned getId() const {
+			return _id;
+		}
+
+		const std::string& str() const {
+			return table().at(_id);
+		}
+
+		operator const std::string&() const {
+			return this->str();
+		}
+
+		bool empty() const {
+			return this->str().empty();
+		}
+
+		friend bool operator==(Symbol a, Symbol b) { return a._id == b._id; }
+		friend bool operator!=(Symbol a, Symbol b) { return a._id != b._id; }
+
+		friend bool operator==(Symbol a, const char* b) = delete;
+		friend bool operator!=(Symbol a, const char* b) = delete;
+
+		friend std::string operator+(Symbol a, Symbol b) { return a.str() + b.str(); }
+		friend std::string operator+(Symbol a, const std::string& b) { return a.str() + b; }
+		friend std::string operator+(const std::string& a, Symbol b) { return a + b.str(); }
+		friend std::string operator+(Symbol a, const char* b) { return a.str() + b; }
+		friend std::string operator+(const char* a, Symbol b) { return a + b.str(); }
+
+	private:
+		unsigned _id;
+
+		/**
+		 * Symbol table
+		 *
+		 * Strings are stored in chunks which are never reallocated, such that
+		 * they can be read without locking while other strings are interned.
+		 */
+		class Table {
+			public:
+				Table() {
+					this->intern("", 0); // default symbol
+				}
+
+				unsigned intern(const char* data, size_t size) {
+					std::lock_guard<std::mutex> lock(mutex);
+
+					auto it = index.find({data, size});
+					if (it != index.end())
+						return it->second;
+
+					if (n == CHUNK * CHUNKS) {
+						std::fprintf(stderr, "vsopc: fatal-error: too many distinct symbols (%u)\n", n);
+						std::abort();
+					}
+
+					unsigned id = n++;
+					std::unique_ptr<std::string[]>& chunk = chunks[id / CHUNK];
+
+					if (not chunk)
+						chunk.reset(new std::string[CHUNK]);
+
+					std::string& str = chunk[id % CHUNK];
+					str.assign(data, size);
+
+					index[{str.data(), str.size()}] = id;
+
+					return id;
+				}
+
+				const std::string& at(unsigned id) const {
+					return chunks[id / CHUNK][id % CHUNK];
+				}
+
+			private:
+				static const unsigned CHUNK = 1 << 14, CHUNKS = 1 << 12;
+
+				/// Characters span, referring to an interned string
+				struct Key {
+					const char* data;
+					size_t size;
+
+					bool operator==(const Key& other) const {
+						return size == other.size and std::memcmp(data, other.data, size) == 0;
+					}
+				};
+
+				/// FNV-1a hash
+				struct Hash {
+					size_t operator()(const Key& key) const {
+						size_t h = 14695981039346656037ull;
+
+						for (size_t i = 0; i < key.size; ++i)
+							h = (h ^ (unsigned char) key.data[i]) * 1099511628211ull;
+
+						return h;
+					}
+				};
+
+				std::mutex mutex;
+				std::unordered_map<Key, unsigned, Hash> index;
+
+				std::unique_ptr<std::string[]> chunks[CHUNKS];
+				unsigned n = 0;
+		};
+
+		static Table& table() {
+			static Table t;
+			return t;
+		}
+};
+
+namespace std {
+	template <>
+	struct hash<Symbol> {
+		size_t operator()(Symbol s) const {
+			return s.getId();
+		}
+	};
+}
+
+#endif
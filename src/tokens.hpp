@@ -0,0 +1,263 @@
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#include "vsop.tab.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Binary token stream (-lex-bin)
+ *
+ *     "VSOPTOK" <version:u8> <flags:u8> <token>* <END:varint>
+ *
+ *     <token> = <kind:varint> <offset:varint> <line:varint> <column:varint> [<payload:varint>]
+ *
+ * Integers are LEB128 varints. The offset is relative to the previous token,
+ * the line too and the column as well if on the same line, such that most
+ * tokens take 5 or 6 bytes.
+ *
+ * The payload of an integer literal is its value, of a real literal the bits
+ * of its value. For other tokens carrying
+ * text (identifiers, keywords, operators and string literals) it refers to a
+ * string table built along the stream: a reference equal to the size of the
+ * table introduces a new string, followed by <length:varint> <bytes>.
+ */
+namespace tokens {
+	static const char MAGIC[] = "VSOPTOK";
+	static const unsigned char VERSION = 1;
+
+	/// Flags of the stream
+	enum { EXT = 1 };
+
+	/// Whether a buffer holds a binary token stream
+	static bool is(const char* data, size_t size) {
+		return size >= sizeof MAGIC and std::memcmp(data, MAGIC, sizeof MAGIC - 1) == 0;
+	}
+
+	/// Whether a token carries text in the string table
+	static bool text(int kind) {
+		return kind != INTEGER_LITERAL and kind != REAL_LITERAL;
+	}
+}
+
+/**
+ * Writer of binary token streams
+ *
+ * @note The output is buffered.
+ */
+class TokenWriter {
+	public:
+		TokenWriter(std::ostream& out, bool ext): out(out) {
+			buffer.append(tokens::MAGIC, sizeof tokens::MAGIC - 1);
+			buffer += (char) tokens::VERSION;
+			buffer += (char) (ext ? tokens::EXT : 0);
+		}
+
+		~TokenWriter() {
+			this->flush();
+		}
+
+		/**
+		 * Write a token
+		 *
+		 * @param offset offset of the token in the source
+		 */
+		void write(int kind, const YYSTYPE& value, const YYLTYPE& loc, size_t offset) {
+			this->varint(kind);
+			this->varint(offset - last_offset);
+
+			if (loc.first_line != last_line) {
+				this->varint(loc.first_line - last_line);
+				this->varint(loc.first_column);
+			} else {
+				this->varint(0);
+				this->varint(loc.first_column - last_column);
+			}
+
+			last_offset = offset;
+			last_line = loc.first_line;
+			last_column = loc.first_column;
+
+			if (kind == INTEGER_LITERAL)
+				this->varint(value.int32);
+			else if (kind == REAL_LITERAL) {
+				uint64_t bits;
+				std::memcpy(&bits, &value.doubl, sizeof bits);
+				this->varint(bits);
+			} else if (kind == STRING_LITERAL)
+				this->string(literals.emplace(std::string(value.str.data, value.str.size), strings).first->second, value.str.data, value.str.size);
+			else if (tokens::text(kind))
+				this->string(symbols.emplace(value.id.getId(), strings).first->second, value.id.str().data(), value.id.str().size());
+
+			if (buffer.size() >= (1 << 16))
+				this->flush();
+		}
+
+		/// Write the end of the stream
+		void end() {
+			this->varint(END);
+			this->flush();
+		}
+
+		void flush() {
+			out.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+
+	private:
+		void varint(uint64_t n) {
+			for (; n >= 0x80; n >>= 7)
+				buffer += (char) ((n & 0x7f) | 0x80);
+
+			buffer += (char) n;
+		}
+
+		/// Write a reference to the string table, and the string if new
+		void string(unsigned ref, const char* data, size_t size) {
+			this->varint(ref);
+
+			if (ref == strings) {
+				this->varint(size);
+				buffer.append(data, size);
+				++strings;
+			}
+		}
+
+		std::ostream& out;
+		std::string buffer;
+
+		size_t last_offset = 0;
+		int last_line = 1, last_column = 1;
+
+		/// String table, by symbol (identifiers, keywords, operators) and by content (literals)
+		std::unordered_map<unsigned, unsigned> symbols;
+		std::unordered_map<std::string, unsigned> literals;
+		unsigned strings = 0;
+};
+
+/**
+ * Reader of binary token streams, feeding the parser
+ *
+ * @note String literals refer to the stream, which should outlive the parse.
+ */
+class TokenReader {
+	public:
+		TokenReader(const char* data, size_t size): p(data), end(data + size) {
+			p += sizeof tokens::MAGIC - 1;
+
+			if (p + 2 > end or (unsigned char) *p++ != tokens::VERSION)
+				p = end; // unsupported
+			else
+				flags = *p++;
+		}
+
+		bool ext() const {
+			return flags & tokens::EXT;
+		}
+
+		/**
+		 * Read the next token
+		 *
+		 * @return the token kind, END at the end of the stream (or if it is corrupted)
+		 */
+		int next(YYSTYPE* value, YYLTYPE* loc) {
+			int kind = this->varint();
+
+			if (kind == END or p >= end)
+				return END;
+
+			offset += this->varint();
+
+			unsigned lines = this->varint();
+			line += lines;
+			column = lines ? this->varint() : column + this->varint();
+
+			loc->first_line = loc->last_line = line;
+			loc->first_column = loc->last_column = column;
+
+			if (kind == INTEGER_LITERAL)
+				value->int32 = this->varint();
+			else if (kind == REAL_LITERAL) {
+				uint64_t bits = this->varint();
+				std::memcpy(&value->doubl, &bits, sizeof bits);
+			} else if (tokens::text(kind)) {
+				Entry& e = this->string();
+
+				if (kind == STRING_LITERAL)
+					value->str = {e.data, e.size};
+				else {
+					if (not e.interned) {
+						e.symbol = Symbol(e.data, e.size);
+						e.interned = true;
+					}
+
+					value->id = e.symbol;
+				}
+			}
+
+			return p > end ? END : kind;
+		}
+
+	private:
+		uint64_t varint() {
+			uint64_t n = 0;
+
+			for (int shift = 0; p < end and shift < 64; shift += 7) {
+				unsigned char b = *p++;
+				n |= (uint64_t) (b & 0x7f) << shift;
+
+				if (not (b & 0x80))
+					return n;
+			}
+
+			p = end + 1; // truncated
+			return 0;
+		}
+
+		/// String table entry
+		struct Entry {
+			const char* data;
+			size_t size;
+
+			bool interned;
+			Symbol symbol;
+		};
+
+		Entry& string() {
+			static Entry none = {"", 0, false, Symbol()};
+
+			size_t ref = this->varint();
+
+			if (ref < table.size())
+				return table[ref];
+
+			if (ref == table.size()) {
+				size_t size = this->varint();
+
+				if (size <= size_t(end - p)) {
+					table.push_back({p, size, false, Symbol()});
+					p += size;
+					return table.back();
+				}
+			}
+
+			p = end + 1; // corrupted
+			return none;
+		}
+
+		const char* p;
+		const char* end;
+		unsigned char flags = 0;
+
+		size_t offset = 0;
+		int line = 1, column = 1;
+
+		std::vector<Entry> table;
+};
+
+#endif
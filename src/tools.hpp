@@ -25,9 +25,12 @@ static std::string char2hex(char c) {
  *
  * @example hex2char("\\x0a") -> '\n'
  */
-static char hex2char(std::string s) {
-	s[0] = '0'; // -> "0xhh"
-	return std::strtol(&s[0], NULL, 16);
+static char hex2char(const char* s) {
+	auto digit = [](char c) {
+		return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; // lowercase
+	};
+
+	return digit(s[2]) * 16 + digit(s[3]);
 }
 
 /**
@@ -110,4 +113,28 @@ static char esc2char(const char* s) {
 	}
 }
 
+/**
+ * Convert a string into its literal representation, without quotes
+ *
+ * @note Quotes, backslashes and non-printable characters are written as "\xhh".
+ * @example str2esc("a\"b\n", 4) -> "a\\x22b\\x0a"
+ */
+static std::string str2esc(const char* s, size_t n) {
+	std::string str;
+	str.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+		switch (s[i]) {
+			case '\"':
+			case '\\': str += char2hex(s[i]); break;
+			default:
+				if (s[i] >= 32 and s[i] <= 126)
+					str += s[i];
+				else
+					str += char2hex(s[i]);
+		}
+
+	return str;
+}
+
 #endif
@@ -1,17 +1,40 @@
 %code top {
 	#include <iostream>
+	#include <stdio.h>
 	#include <string.h>
+
+	#include "tools.hpp"
 }
 
 %code requires {
 	#include "ast.hpp"
+
+	#include <string>
+
+	/**
+	 * Span of characters
+	 *
+	 * String literals refer to the source buffer, which is scanned in place,
+	 * instead of copying it. They are only copied into the abstract syntax tree.
+	 */
+	struct yyspan {
+		const char* data;
+		size_t size;
+
+		operator std::string() const {
+			return std::string(data, size);
+		}
+	};
 }
 
 %union // yylval
 {
+	YYSTYPE() {} // the members (e.g. symbols) are assigned by the scanner
+
 	int int32;
 	double doubl;
-	char* id;
+	yyspan str;
+	Symbol id;
 	Class* clas;
 	ClassDefinition* defn;
 	Field* field;
@@ -25,48 +48,190 @@
 
 %code requires {
 	#define YYLTYPE yyltype
+	#define YYLTYPE_IS_TRIVIAL 1 // copyable with memcpy, such that the parser stack can grow (past 200 states)
 
 	typedef struct yyltype {
 		int first_line = 1;
 		int first_column = 1;
 		int last_line = 1;
 		int last_column = 1;
-		char* filename = NULL;
 	} yyltype;
 }
 
 %locations // yylloc
 
-%{
-	/* vsopc */
+%code requires {
+	#include <iostream>
+	#include <string>
+	#include <vector>
+
+	#ifndef YY_TYPEDEF_YY_SCANNER_T
+	#define YY_TYPEDEF_YY_SCANNER_T
+	typedef void* yyscan_t;
+	#endif
+
+	class TokenReader;
+
+	/**
+	 * Parsing context
+	 *
+	 * It holds the whole state of a parse (previously globals), such that
+	 * several sources can be parsed concurrently, each with its own context.
+	 */
+	struct yycontext {
+		yycontext(const std::string& filename, int mode, std::ostream& out, std::ostream& err):
+			filename(filename), mode(mode), out(out), err(err) {}
+
+		/// Name of the source, for error messages
+		std::string filename;
+
+		/// Index of the source, for multi-file programs
+		int file = 0;
+
+		/// Parsing mode (START_LEXER, START_PARSER, etc.), consumed by the first token
+		int mode;
+
+		/// Output (tokens) and error streams
+		std::ostream& out;
+		std::ostream& err;
+
+		/// Parsed classes and top-level functions
+		List<Class> classes;
+		List<Method> functions;
+
+		/// Arena owning the nodes of the parse, released with the context
+		Arena arena;
+
+		/// Number of error messages sent
+		int errs = 0;
+
+		/// Extensions trigger
+		bool ext = false;
+
+		/**
+		 * String buffer
+		 *
+		 * It is used for tokens parsed in several rule matches, like strings, if they cannot refer to the source (escape sequences).
+		 */
+		std::string buffer;
+
+		/// Start of the current string literal in the source
+		const char* literal = nullptr;
+
+		/// Whether the current string literal is in the string buffer
+		bool escaped = false;
+
+		/// Location stack of nested encapsulated environments (e.g. comments)
+		std::vector<YYLTYPE> stack;
+
+		/// Binary token stream replacing the scanner, if any (see tokens.hpp)
+		TokenReader* tokens = nullptr;
+
+		/// Output buffer of the tokens (-lex)
+		std::string output;
+
+		/// Create a node in the arena
+		template <typename T, typename... Args>
+		T* make(Args&&... args) {
+			return arena.make<T>(std::forward<Args>(args)...);
+		}
+
+		/// Create a list of nodes in the arena, with its elements in the arena as well
+		template <typename T>
+		List<T>* list() {
+			return arena.make<List<T>>(arena);
+		}
+
+		/// Set the position of a node
+		void locate(Node* n, const YYLTYPE& loc) const {
+			n->pos.line = loc.first_line;
+			n->pos.column = loc.first_column;
+			n->pos.file = file;
+		}
+
+		/**
+		 * Print message on the output along with a location
+		 *
+		 *     <line>,<column>,msg
+		 *
+		 * @note The output is buffered, see flush().
+		 */
+		void print(const YYLTYPE& loc, const std::string& msg) {
+			this->print(loc, msg.data(), msg.size());
+		}
+
+		/**
+		 * Print a token and its value on the output along with a location
+		 *
+		 *     <line>,<column>,kind,value
+		 */
+		void print(const YYLTYPE& loc, const char* kind, const std::string& value) {
+			this->print(loc, kind, strlen(kind), &value);
+		}
+
+		/// Write the buffered output to the output stream
+		void flush() {
+			out.write(output.data(), output.size());
+			output.clear();
+		}
+
+		/**
+		 * Print error message on the error stream along with a location
+		 *
+		 *     <filename>:<line>:<column>: msg
+		 */
+		void error(const Position& pos, const std::string& msg) {
+			err << filename << ':' << pos.line << ':' << pos.column << ':';
+			err << ' ' << msg << std::endl;
+			++errs;
+		}
+
+		void error(const YYLTYPE& loc, const std::string& msg) {
+			this->error(Position({loc.first_line, loc.first_column, file}), msg);
+		}
+
+	private:
+		void print(const YYLTYPE& loc, const char* msg, size_t size, const std::string* value = nullptr) {
+			char position[32];
+			int n = snprintf(position, sizeof position, "%d,%d,", loc.first_line, loc.first_column);
+
+			output.append(position, n);
+			output.append(msg, size);
+
+			if (value) {
+				output += ',';
+				output += *value;
+			}
+
+			output += '\n';
+
+			if (output.size() >= (1 << 16))
+				this->flush();
+		}
+	};
+}
+
+%code provides {
+	int yyread(yycontext&, char*, size_t);
+	int yydump(yycontext&, char*, size_t);
+	int yyreplay(yycontext&, const char*, size_t);
+}
 
-	extern int yymode;
-	extern List<Class> yyclasses;
-	extern List<Method> yyfunctions;
+%define api.pure full
+%param {yyscan_t scanner}
 
+%{
 	/* flex */
 
-	extern FILE* yyin;
-	extern bool yyext;
+	yycontext* yyget_extra(yyscan_t);
+
+	/// Context of the parse
+	#define yyextra yyget_extra(scanner)
 
 	/* bison */
 
-	/**
-	 * Number of error messages sent
-	 *
-	 * @see yyerror
-	 */
-	int yyerrs = 0;
-
-	int yylex(void);
-	int yyparse(void);
-	void yylocate(Node*, const YYLTYPE&);
-	void yyrelocate(int, int);
-	void yyrelocate(const YYLTYPE&);
-	void yyprint(const std::string&);
-	void yyerror(const std::string&);
-	bool yyopen(const char*);
-	void yyclose();
+	int yylex(YYSTYPE*, YYLTYPE*, yyscan_t);
+	void yyerror(YYLTYPE*, yyscan_t, const std::string&);
 %}
 
 %define parse.error verbose
@@ -77,7 +242,7 @@
 
 %token <int32> INTEGER_LITERAL "integer-literal"
 %token <doubl> REAL_LITERAL "real-literal" // /!\ tweak lexer to support
-%token <id> STRING_LITERAL "string-literal"
+%token <str> STRING_LITERAL "string-literal"
 %token <id> TYPE_IDENTIFIER "type-identifier"
 %token <id> OBJECT_IDENTIFIER "object-identifier"
 
@@ -168,17 +333,17 @@ start:			START_LEXER token // -lex
 
 token:			/* */
 				| token INTEGER_LITERAL
-				{ yyprint("integer-literal," + Integer($2).toString()); }
+				{ yyextra->print(@2, "integer-literal", std::to_string($2)); }
 				| token REAL_LITERAL
-				{ yyprint("real-literal," + Real($2).toString()); }
+				{ yyextra->print(@2, "real-literal", std::to_string($2)); }
 				| token STRING_LITERAL
-				{ yyprint("string-literal," + String($2).toString());  }
+				{ yyextra->print(@2, "string-literal", "\"" + str2esc($2.data, $2.size) + "\""); }
 				| token TYPE_IDENTIFIER
-				{ yyprint("type-identifier," + std::string($2)); }
+				{ yyextra->print(@2, "type-identifier", $2); }
 				| token object
-				{ yyprint("object-identifier," + std::string($<id>2)); }
+				{ yyextra->print(@2, "object-identifier", $<id>2); }
 				| token keyword
-				{ yyprint($<id>2); };
+				{ yyextra->print(@2, $<id>2); };
 
 object:			OBJECT_IDENTIFIER | "self";
 
@@ -192,7 +357,7 @@ program:		program-aux
 				{ yyerrok; };
 
 program-aux:	class
-				{ yyclasses.push($1); };
+				{ yyextra->classes.push($1); };
 
 extended:		extended-aux
 				| extended-aux extended
@@ -202,90 +367,87 @@ extended:		extended-aux
 				{ yyerrok; };
 
 extended-aux:	class
-				{ yyclasses.push($1); }
+				{ yyextra->classes.push($1); }
 				| method
-				{ yyfunctions.push($1); };
+				{ yyextra->functions.push($1); };
 
 class:			"class" type_id class-parent "{" class-aux
-				{ $$ = new Class($2, $3, $5->fields.reverse(), $5->methods.reverse()); yylocate($$, @$); delete $5; };
+				{ $$ = yyextra->make<Class>($2, $3, std::move($5->fields.reverse()), std::move($5->methods.reverse())); yyextra->locate($$, @$); };
 
 class-parent:	/* */
-				{ $$ = strdup("Object"); }
+				{ $$ = Symbol("Object"); }
 				| "extends" type_id
 				{ $$ = $2; };
 
 class-aux:		"}"
-				{ $$ = new ClassDefinition(); }
+				{ $$ = yyextra->make<ClassDefinition>(yyextra->arena); }
 				| field ";" class-aux
 				{ $3->fields.push($1); $$ = $3;	}
 				| method class-aux
 				{ $2->methods.push($1); $$ = $2;	}
 				| error "}"
-				{ $$ = new ClassDefinition(); yyerrok; }
+				{ $$ = yyextra->make<ClassDefinition>(yyextra->arena); yyerrok; }
 				| error ";" class-aux
 				{ $$ = $3; yyerrok; }
 				| error block class-aux /* prevent unmatched { */
 				{ $$ = $3; yyerrok; }
 				| error END
-				{ $$ = new ClassDefinition();
-					yyrelocate(@$);
-					yyerror("syntax error, unexpected end-of-file, missing ending } of class declaration");
+				{ $$ = yyextra->make<ClassDefinition>(yyextra->arena);
+					yyextra->error(@$, "syntax error, unexpected end-of-file, missing ending } of class declaration");
 				};
 
 field:			object_id ":" type init
-				{ $$ = new Field($1, $3, $4); yylocate($$, @$); };
+				{ $$ = yyextra->make<Field>($1, $3, $4); yyextra->locate($$, @$); };
 
 fields:			"(" ")"
-				{ $$ = new List<Field>(); }
+				{ $$ = yyextra->list<Field>(); }
 				| "(" fields-aux
 				{ $$ = $2; };
 fields-aux:		field ")"
-				{ $$ = new List<Field>(); $$->push($1); }
+				{ $$ = yyextra->list<Field>(); $$->push($1); }
 				| field "," fields-aux
 				{ $3->push($1); $$ = $3; }
 				| error ")"
-				{ $$ = new List<Field>(); yyerrok; }
+				{ $$ = yyextra->list<Field>(); yyerrok; }
 				| error "," fields-aux
 				{ $$ = $3; yyerrok; };
 
 prototype:		object_id formals ":" type
-				{ $$ = new Method($1, $2->reverse(), $4, NULL); yylocate($$, @$); delete $2; };
+				{ $$ = yyextra->make<Method>($1, std::move($2->reverse()), $4, nullptr); yyextra->locate($$, @$); };
 
 method:			prototype block
-				{ $1->block = std::make_shared<Block>($2->reverse()); $$ = $1; yylocate($$->block.get(), @2); delete $2; }
+				{ $1->block = yyextra->make<Block>(std::move($2->reverse())); $$ = $1; yyextra->locate($$->block, @2); }
 				| "extern" prototype ";"
 				{ $$ = $2; }
 				| "extern" "vararg" prototype ";"
 				{ $$ = $3; $$->variadic = true; };
 
 formal:			object_id ":" type // possible improvement -> merge field and formal
-				{ $$ = new Formal($1, $3); yylocate($$, @$); };
+				{ $$ = yyextra->make<Formal>($1, $3); yyextra->locate($$, @$); };
 
 formals:		"(" ")"
-				{ $$ = new List<Formal>(); }
+				{ $$ = yyextra->list<Formal>(); }
 				| "(" formals-aux
 				{ $$ = $2; };
 formals-aux:	formal ")"
-				{ $$ = new List<Formal>(); $$->push($1); }
+				{ $$ = yyextra->list<Formal>(); $$->push($1); }
 				| formal "," formals-aux
 				{ $3->push($1); $$ = $3; }
 				| error ")"
-				{ $$ = new List<Formal>(); yyerrok; }
+				{ $$ = yyextra->list<Formal>(); yyerrok; }
 				| error "," formals-aux
 				{ $$ = $3; yyerrok; };
 
 object_id:		OBJECT_IDENTIFIER
 				| TYPE_IDENTIFIER
-				{ $$ = strdup(("my" + std::string($1)).c_str());
-					yyrelocate(@$);
-					yyerror("syntax error, unexpected type-identifier " + std::string($1) + ", replaced by " + std::string($$));
+				{ $$ = Symbol("my" + $1);
+					yyextra->error(@$, "syntax error, unexpected type-identifier " + std::string($1) + ", replaced by " + std::string($$));
 				};
 
 type_id:		TYPE_IDENTIFIER
 				| OBJECT_IDENTIFIER
-				{ $$ = strdup($1); *$$ -= 'a' - 'A';
-					yyrelocate(@$);
-					yyerror("syntax error, unexpected object-identifier " + std::string($1) + ", replaced by " + std::string($$));
+				{ std::string id = $1; id[0] -= 'a' - 'A'; $$ = Symbol(id);
+					yyextra->error(@$, "syntax error, unexpected object-identifier " + std::string($1) + ", replaced by " + std::string($$));
 				};
 
 type:			type_id
@@ -298,33 +460,31 @@ type:			type_id
 block:			"{" block-aux
 				{ $$ = $2; }
 				| "{" "}"
-				{ $$ = new List<Expr>();
-					yyrelocate(@$);
-					yyerror("syntax error, empty block");
+				{ $$ = yyextra->list<Expr>();
+					yyextra->error(@$, "syntax error, empty block");
 				};
 block-aux:		expr "}"
-				{ $$ = new List<Expr>(); $$->push($1); }
+				{ $$ = yyextra->list<Expr>(); $$->push($1); }
 				| expr ";" block-aux
 				{ $3->push($1); $$ = $3; }
 				| error "}"
-				{ $$ = new List<Expr>(); yyerrok; }
+				{ $$ = yyextra->list<Expr>(); yyerrok; }
 				| error ";" block-aux
 				{ $$ = $3; }
 				| error block block-aux /* prevent unmatched { */
 				{ $$ = $3; }
 				| error END
-				{ $$ = new List<Expr>();
-					yyrelocate(@$);
-					yyerror("syntax error, unexpected end-of-file, missing ending } of block");
+				{ $$ = yyextra->list<Expr>();
+					yyextra->error(@$, "syntax error, unexpected end-of-file, missing ending } of block");
 				};
 
 expr:			expr-aux
-				{ $$ = $1; yylocate($$, @$); };
+				{ $$ = $1; yyextra->locate($$, @$); };
 expr-aux:		if
 				| while
 				| for
 				| "break"
-				{ $$ = new Break(); }
+				{ $$ = yyextra->make<Break>(); }
 				| let
 				| lets
 				| unary
@@ -332,36 +492,36 @@ expr-aux:		if
 				| call
 				| literal
 				| "new" type_id
-				{ $$ = new New($2); }
+				{ $$ = yyextra->make<New>($2); }
 				| object_id
-				{ $$ = new Identifier($1); }
+				{ $$ = yyextra->make<Identifier>($1); }
 				| object_id "<-" expr
-				{ $$ = new Assign($1, $3); }
+				{ $$ = yyextra->make<Assign>($1, $3); }
 				| "(" ")"
-				{ $$ = new Unit(); }
+				{ $$ = yyextra->make<Unit>(); }
 				| "(" expr ")"
 				{ $$ = $2; }
 				| block
-				{ $$ = new Block($1->reverse()); delete $1; }
+				{ $$ = yyextra->make<Block>(std::move($1->reverse())); }
 				| "self"
-				{ $$ = new Self(); };
+				{ $$ = yyextra->make<Self>(); };
 
 if:				"if" expr "then" expr
-				{ $$ = new If($2, $4, NULL); }
+				{ $$ = yyextra->make<If>($2, $4, nullptr); }
 				| "if" expr "then" expr "else" expr
-				{ $$ = new If($2, $4, $6); };
+				{ $$ = yyextra->make<If>($2, $4, $6); };
 
 while:			"while" expr "do" expr
-				{ $$ = new While($2, $4); };
+				{ $$ = yyextra->make<While>($2, $4); };
 
 for:			"for" object_id "<-" expr "to" expr "do" expr
-				{ $$ = new For($2, $4, $6, $8); };
+				{ $$ = yyextra->make<For>($2, $4, $6, $8); };
 
 let:			"let" object_id ":" type init "in" expr
-				{ $$ = new Let($2, $4, $5, $7); };
+				{ $$ = yyextra->make<Let>($2, $4, $5, $7); };
 
 lets:			"lets" fields "in" expr
-				{ $$ = new Lets($2->reverse(), $4); };
+				{ $$ = yyextra->make<Lets>(std::move($2->reverse()), $4); };
 
 init:			/* */
 				{ $$ = NULL; }
@@ -369,126 +529,75 @@ init:			/* */
 				{ $$ = $2; };
 
 unary:			"not" expr
-				{ $$ = new Unary(Unary::NOT, $2); }
+				{ $$ = yyextra->make<Unary>(Unary::NOT, $2); }
 				| "-" expr %prec UMINUS
-				{ $$ = new Unary(Unary::MINUS, $2); }
+				{ $$ = yyextra->make<Unary>(Unary::MINUS, $2); }
 				| "isnull" expr
-				{ $$ = new Unary(Unary::ISNULL, $2); };
+				{ $$ = yyextra->make<Unary>(Unary::ISNULL, $2); };
 
 binary:			expr "and" expr
-				{ $$ = new Binary(Binary::AND, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::AND, $1, $3); }
 				| expr "or" expr
-				{ $$ = new Binary(Binary::OR, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::OR, $1, $3); }
 				| expr "=" expr
-				{ $$ = new Binary(Binary::EQUAL, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::EQUAL, $1, $3); }
 				| expr "!=" expr
-				{ $$ = new Binary(Binary::NEQUAL, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::NEQUAL, $1, $3); }
 				| expr "<" expr
-				{ $$ = new Binary(Binary::LOWER, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::LOWER, $1, $3); }
 				| expr "<=" expr
-				{ $$ = new Binary(Binary::LOWER_EQUAL, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::LOWER_EQUAL, $1, $3); }
 				| expr ">" expr
-				{ $$ = new Binary(Binary::GREATER, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::GREATER, $1, $3); }
 				| expr ">=" expr
-				{ $$ = new Binary(Binary::GREATER_EQUAL, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::GREATER_EQUAL, $1, $3); }
 				| expr "+" expr
-				{ $$ = new Binary(Binary::PLUS, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::PLUS, $1, $3); }
 				| expr "-" expr
-				{ $$ = new Binary(Binary::MINUS, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::MINUS, $1, $3); }
 				| expr "*" expr
-				{ $$ = new Binary(Binary::TIMES, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::TIMES, $1, $3); }
 				| expr "/" expr
-				{ $$ = new Binary(Binary::DIV, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::DIV, $1, $3); }
 				| expr "^" expr
-				{ $$ = new Binary(Binary::POW, $1, $3); }
+				{ $$ = yyextra->make<Binary>(Binary::POW, $1, $3); }
 				| expr "mod" expr
-				{ $$ = new Binary(Binary::MOD, $1, $3); };
+				{ $$ = yyextra->make<Binary>(Binary::MOD, $1, $3); };
 
 literal:		INTEGER_LITERAL
-				{ $$ = new Integer($1); }
+				{ $$ = yyextra->make<Integer>($1); }
 				| STRING_LITERAL
-				{ $$ = new String($1); }
+				{ $$ = yyextra->make<String>($1); }
 				| "true"
-				{ $$ = new Boolean(true); }
+				{ $$ = yyextra->make<Boolean>(true); }
 				| "false"
-				{ $$ = new Boolean(false); };
+				{ $$ = yyextra->make<Boolean>(false); };
 
 call:			expr "." object_id args
-				{ $$ = new Call($1, $3, $4->reverse()); delete $4; }
+				{ $$ = yyextra->make<Call>($1, $3, std::move($4->reverse())); }
 				| object_id args
-				{ $$ = new Call(yyext ? (Expr*) new Unit() : (Expr*) new Self(), $1, $2->reverse()); delete $2; };
+				{ $$ = yyextra->make<Call>(yyextra->ext ? (Expr*) yyextra->make<Unit>() : (Expr*) yyextra->make<Self>(), $1, std::move($2->reverse())); };
 
 args:			"(" ")"
-				{ $$ = new List<Expr>(); }
+				{ $$ = yyextra->list<Expr>(); }
 				| "(" args-aux
 				{ $$ = $2; };
 args-aux:		expr ")"
-				{ $$ = new List<Expr>(); $$->push($1); }
+				{ $$ = yyextra->list<Expr>(); $$->push($1); }
 				| expr "," args-aux
 				{ $3->push($1); $$ = $3; }
 				| error ")"
-				{ $$ = new List<Expr>(); yyerrok; }
+				{ $$ = yyextra->list<Expr>(); yyerrok; }
 				| error "," args-aux
 				{ $$ = $3; }
 				| error END
-				{ $$ = new List<Expr>();
-					yyrelocate(@$);
-					yyerror("syntax error, unexpected end-of-file, missing ending ) of argument list");
+				{ $$ = yyextra->list<Expr>();
+					yyextra->error(@$, "syntax error, unexpected end-of-file, missing ending ) of argument list");
 				};
 
 %%
 
-/// Set the position of a node
-void yylocate(Node* n, const YYLTYPE& loc) {
-	n->pos.line = loc.first_line;
-	n->pos.column = loc.first_column;
-}
-
-/**
- * Modify the current file location
- *
- * @remark Only the first cursor of the location window is modified, so that subsequent locations are not affected.
- */
-void yyrelocate(const YYLTYPE& loc) {
-	yylloc.first_line = loc.first_line;
-	yylloc.first_column = loc.first_column;
-}
-
-void yyrelocate(int line, int column) {
-	yylloc.first_line = line;
-	yylloc.first_column = column;
-}
-
-/**
- * Print message on standard output along with the current location
- *
- *     <line>,<column>,msg
- */
-void yyprint(const std::string& msg) {
-	std::cout << yylloc.first_line << ',' << yylloc.first_column << ',';
-	std::cout << msg << std::endl;
-}
-
-/**
- * Print error message in standard error along with current location
- *
- *     <filename>:<line>:<column>: msg
- */
-void yyerror(const std::string& msg) {
-	std::cerr << yylloc.filename << ':' << yylloc.first_line << ':' << yylloc.first_column << ':';
-	std::cerr << ' ' << msg << std::endl;
-	++yyerrs;
-}
-
-/// Open file
-bool yyopen(const char* filename) {
-	yylloc.filename = strdup(filename);
-	yyin = fopen(yylloc.filename, "r");
-
-	return yyin;
-}
-
-/// Close file
-void yyclose() {
-	fclose(yyin);
+/// Report a syntax error at a location
+void yyerror(YYLTYPE* loc, yyscan_t scanner, const std::string& msg) {
+	yyextra->error(*loc, msg);
 }
@@ -1,76 +1,83 @@
-#include "vsop.tab.h"
-
+#include "vsopc.hpp"
+#include "cache.hpp"
+#include "llvm.hpp"
+#include "mapping.hpp"
+#include "server.hpp"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
 using namespace std;
 
-/* bison */
-
-extern int yyerrs;
-
-extern int yyparse(void);
-extern void yyrelocate(int, int);
-extern void yyprint(const string&);
-extern void yyerror(const string&);
-extern bool yyopen(const char*);
-extern void yyclose();
-
-/* vsopc */
-
-int yymode = START_PARSER;
-
-List<Class> yyclasses;
-List<Method> yyfunctions;
-
-Program* program;
-LLVMHelper helper("VSOP");
-
-void lexer() {
-	if (yymode == START_EXT_PARSER)
-		yymode = START_EXT_LEXER;
-	else
-		yymode = START_LEXER;
-
-	yyparse();
-}
-
-void parser() {
-	yyparse();
-
-	program = new Program(yyclasses, yyfunctions);
-}
-
-void checker() {
-	program->declaration(helper);
-	program->codegen(*program, helper);
-
-	for (Error& e: helper.errors) {
-		yyrelocate(e.pos.line, e.pos.column);
-		yyerror("semantic error, " + e.msg);
-	}
-}
-
 enum flags {
 	lex,
+	lexbin,
+	emitast,
+	loadast,
 	parse,
 	check,
 	llvmir,
 	ext,
 	nopt,
+	object,
+	assembly,
+	march,
+	mcpu,
+	run,
+	separator,
+	level,
+	timing,
+	trace,
+	nocache,
+	cachestats,
+	jobs,
+	instrument,
+	profile,
+	gc,
+	server,
+	client,
 	none
 };
 
 flags hashflag(const string& str) {
 	if (str == "-lex") return lex;
+	if (str == "-lex-bin") return lexbin;
+	if (str.compare(0, 10, "-emit-ast=") == 0) return emitast;
+	if (str.compare(0, 10, "-load-ast=") == 0) return loadast;
 	if (str == "-parse") return parse;
 	if (str == "-check") return check;
 	if (str == "-llvm") return llvmir;
 	if (str == "-ext") return ext;
 	if (str == "-nopt") return nopt;
+	if (str == "-c") return object;
+	if (str == "-S") return assembly;
+	if (str.compare(0, 7, "-march=") == 0) return march;
+	if (str.compare(0, 6, "-mcpu=") == 0) return mcpu;
+	if (str == "-run") return run;
+	if (str == "--") return separator;
+	if (str == "-time-phases") return timing;
+	if (str == "-no-cache") return nocache;
+	if (str == "-cache-stats") return cachestats;
+	if (str.compare(0, 7, "-trace=") == 0) return trace;
+	if (str.size() > 2 and str.compare(0, 2, "-j") == 0 and isdigit(str[2])) return jobs;
+	if (str.compare(0, 25, "-field-layout-instrument=") == 0) return instrument;
+	if (str.compare(0, 22, "-field-layout-profile=") == 0) return profile;
+	if (str == "-gc") return gc;
+	if (str == "-server" or str.compare(0, 8, "-server=") == 0) return server;
+	if (str.compare(0, 8, "-client=") == 0) return client;
+	if (str == "-O0" or str == "-O1" or str == "-O2" or str == "-O3" or str == "-Os") return level;
 	return none;
 }
 
@@ -78,75 +85,312 @@ int sys(const string& cmd) {
 	return system(cmd.c_str());
 }
 
-int main (int argc, char* argv[]) {
-	bool lexflag = false, parseflag = false, checkflag = false, llvmflag = false, execflag = true, optflag = true;
-	string filename;
+/// Identity of the compiler executable, for cache keys
+string version(const char* argv0) {
+	string exe = llvm::sys::fs::getMainExecutable(argv0, (void*) &version);
+	llvm::sys::fs::file_status st;
+
+	if (llvm::sys::fs::status(exe, st))
+		return exe;
+
+	return exe + ":" + to_string(st.getSize()) + ":" + to_string(llvm::sys::toTimeT(st.getLastModificationTime()));
+}
+
+/// Identity of the host processor (-march=native or -mcpu=native), for cache keys
+string host() {
+	string str = llvm::sys::getHostCPUName().str();
+
+	// Processors of the same name may differ by their features
+	llvm::StringMap<bool> features;
+	vector<string> enabled;
+
+	if (llvm::sys::getHostCPUFeatures(features))
+		for (auto& it: features)
+			enabled.push_back((it.second ? '+' : '-') + it.first().str());
+
+	sort(enabled.begin(), enabled.end()); // StringMap is unordered
+
+	for (const string& feature: enabled)
+		str += ',' + feature;
+
+	return str;
+}
+
+/**
+ * Restore a cached output
+ *
+ * @param output output file, or standard output if empty
+ */
+bool restore(const string& output, const string& content, bool executable) {
+	if (output.empty()) {
+		cout << content;
+		return true;
+	}
+
+	ofstream out(output, ios::binary);
+	out << content;
+	out.close();
+
+	if (executable)
+		llvm::sys::fs::setPermissions(output, llvm::sys::fs::all_read | llvm::sys::fs::all_exe | llvm::sys::fs::owner_write);
+
+	return bool(out);
+}
+
+/**
+ * Compile a multi-file program into one object per source (-c) or into an executable
+ *
+ * @note Up to -llvm, the tokens, trees or code of the whole program are written to the standard output instead.
+ * @note The executable is named after the first source. Multi-file programs are not cached.
+ */
+int link(const vector<string>& filenames, vsopc::Options& options, bool objflag) {
+	if (options.stage == vsopc::ASSEMBLY or options.stage == vsopc::RUN) {
+		cerr << "vsopc: error: multiple input files are not supported by -S and -run" << endl;
+		return 1;
+	}
+
+	vector<vsopc::Source> sources;
+
+	for (const string& filename: filenames) {
+		auto source = make_shared<Mapping>(filename);
+
+		if (not *source) {
+			cerr << "vsopc: fatal-error: " << filename << ": No such file or directory" << endl;
+			return 1;
+		}
+
+		sources.push_back({filename, "", source});
+	}
+
+	if (options.stage != vsopc::OBJECT) // -lex, -parse, -check or -llvm
+		return vsopc::compile(sources, options, cout, cerr).errors;
+
+	ostringstream code;
+
+	vsopc::Result result = vsopc::compile(sources, options, code, cerr);
+
+	if (result.errors)
+		return result.errors;
+
+	// Write object files
+	string objects;
+
+	for (size_t i = 0; i < sources.size(); ++i) {
+		string object = filenames[i].substr(0, filenames[i].find_last_of('.')) + ".o";
+
+		result.errors += not restore(object, result.objects[i], false);
+		objects += object + " ";
+	}
+
+	if (objflag)
+		return result.errors;
+
+	// Create executable
+	string basename = filenames.front().substr(0, filenames.front().find_last_of('.'));
+
+	if (result.errors == 0 and system(NULL))
+		result.errors += sys("clang " + objects + "-lm -o " + basename) != 0;
+
+	for (const string& filename: filenames)
+		remove((filename.substr(0, filename.find_last_of('.')) + ".o").c_str());
+
+	return result.errors;
+}
+
+/// Compile a single command line
+int compile(int argc, char* argv[]) {
+	vsopc::Options options;
+
+	bool parseflag = false, checkflag = false, llvmflag = false, execflag = true;
+	bool objflag = false, asmflag = false, runflag = false, cacheflag = true, statsflag = false;
+	vector<string> filenames;
+	vector<string> args; // program arguments (-run)
 
 	for (int i = 1; i < argc; ++i)
-		switch (hashflag(argv[i])) {
+		if (not args.empty()) // after --
+			args.push_back(argv[i]);
+		else switch (hashflag(argv[i])) {
 			case llvmir: llvmflag = true; // falltrought
 			case check: checkflag = true;
 			case parse: parseflag = true;
-			case lex: lexflag = true; execflag = false; break;
-			case ext: yymode = START_EXT_PARSER; break;
-			case nopt: optflag = false; break;
-			default: filename = argv[i];
+			case lex: execflag = false; break;
+			case lexbin: execflag = false; options.binary = true; break;
+			case emitast: options.ast_file = string(argv[i]).substr(10); break;
+			case loadast: filenames.push_back(string(argv[i]).substr(10)); break; // detected by its header
+			case ext: options.ext = true; break;
+			case nopt: options.speed_level = options.size_level = 0; break;
+			case level:
+				if (argv[i][2] == 's') { // -Os
+					options.speed_level = 2;
+					options.size_level = 1;
+				} else {
+					options.speed_level = argv[i][2] - '0';
+					options.size_level = 0;
+				}
+				break;
+			case object: objflag = true; break;
+			case assembly: asmflag = true; break;
+			case march: options.arch = string(argv[i]).substr(7); break;
+			case mcpu: options.cpu = string(argv[i]).substr(6); break;
+			case run: runflag = true; break;
+			case timing: options.timing = true; break;
+			case trace: options.trace = string(argv[i]).substr(7); break;
+			case nocache: cacheflag = false; break;
+			case cachestats: statsflag = true; break;
+			case jobs: options.jobs = atoi(argv[i] + 2); break;
+			case instrument: options.field_instrument = string(argv[i]).substr(25); break;
+			case profile: options.field_profile = string(argv[i]).substr(22); break;
+			case gc: options.gc = true; break;
+			case separator: args.push_back(""); break; // placeholder for the program name
+			default: filenames.push_back(argv[i]);
 		}
 
 	if (execflag)
-		lexflag = parseflag = checkflag = llvmflag = true;
+		options.stage = runflag ? vsopc::RUN : asmflag ? vsopc::ASSEMBLY : vsopc::OBJECT;
+	else
+		options.stage = llvmflag ? vsopc::LLVM : checkflag ? vsopc::CHECK : parseflag ? vsopc::PARSE : vsopc::LEX;
+
+	Cache cache;
+
+	if (statsflag and filenames.empty()) { // -cache-stats only
+		cache.stats(cout);
+		return 0;
+	}
 
-	if (filename.empty()) {
-		cerr << "vsopc : error: no input file" << endl;
+	if (filenames.empty()) {
+		cerr << "vsopc: error: no input file" << endl;
 		return 1;
-	} else if (not yyopen(filename.c_str())) {
+	}
+
+	if (filenames.size() > 1)
+		return link(filenames, options, objflag);
+
+	const string& filename = filenames.front();
+	auto source = make_shared<Mapping>(filename);
+
+	if (not *source) {
 		cerr << "vsopc: fatal-error: " << filename << ": No such file or directory" << endl;
 		return 1;
 	}
 
-	helper.module->setSourceFileName(filename);
-
-	if (lexflag) { // if -lex or higher
-		if (parseflag) { // if -parse or higher
-			parser();
-
-			if (checkflag) { // if -check or higher
-				checker();
-
-				if (llvmflag) { // if -llvm or higher
-					if (optflag)
-						yyerrs += helper.passes();
-
-					if (yyerrs == 0) { // no errors
-						if (execflag and system(NULL)) {
-							// Get basename
-							string basename = filename.substr(0, filename.find_last_of('.'));
-							string object = "resources/runtime/object";
-
-							// Dump LLVM IR code
-							ofstream out(basename + ".ll");
-							out << helper.dump();
-							out.close();
-
-							// Compile basename.ll to assembly
-							sys("llc-9 " + basename + ".ll -O2");
-
-							// Bind with object.s and create executable
-							sys("clang " + basename + ".s /usr/local/lib/vsopc/object.s -lm -o " + basename);
-						} else
-							cout << helper.dump();
-					}
-				} else
-					cout << program->toString(true) << endl;
-			} else
-				cout << program->toString(false) << endl;
-
-			delete program;
-		} else
-			lexer();
+	options.filename = filename;
+
+	if (not args.empty())
+		args.front() = filename;
+	else
+		args.push_back(filename);
+
+	options.args = args;
+
+	// Get basename and output file (standard output if empty)
+	string basename = filename.substr(0, filename.find_last_of('.'));
+	string output = not execflag ? "" : asmflag ? basename + ".s" : objflag ? basename + ".o" : basename;
+
+	// Compilation cache, only for -llvm and higher without profiling (the profile is not part of the key)
+	cacheflag = cacheflag and (llvmflag or execflag) and not runflag and options.trace.empty() and not options.timing and options.ast_file.empty();
+	cacheflag = cacheflag and options.field_instrument.empty() and options.field_profile.empty();
+
+	if (cacheflag) {
+		cache.update(llvm::StringRef(source->data(), source->size()));
+		cache.update(version(argv[0]));
+		cache.update(llvm::StringRef((const char*) runtime_bc, runtime_bc_size));
+		cache.update(options.ext ? "-ext" : "");
+		cache.update(options.gc ? "-gc" : "");
+		cache.update(not execflag ? "-llvm" : asmflag ? "-S" : objflag ? "-c" : "");
+		cache.update(not execflag ? filename : ""); // module identifier and source filename of the IR
+		cache.update(to_string(options.speed_level) + to_string(options.size_level));
+		cache.update(options.arch == "native" or options.cpu == "native" ? host() : "");
+		cache.update(options.arch);
+		cache.update(options.cpu);
+
+		string content;
+
+		if (cache.fetch(content)) { // skip the compilation entirely
+			bool restored = restore(output, content, execflag and not asmflag and not objflag);
+
+			if (statsflag)
+				cache.stats(cerr);
+
+			return restored ? 0 : 1;
+		}
+	}
+
+	// Tokens and trees are streamed, code is buffered
+	ostringstream code;
+	ostream& out = execflag or llvmflag ? code : cout;
+
+	vsopc::Result result = vsopc::compile(vector<vsopc::Source>({{filename, "", source}}), options, out, cerr);
+
+	if (options.stage == vsopc::RUN)
+		return result.errors ? result.errors : result.status;
+
+	if (result.errors == 0 and (execflag or llvmflag)) {
+		string content = code.str();
+
+		if (not execflag) // -llvm
+			cout << content;
+		else if (not result.objects.empty()) { // partitions (-jN)
+			string objects;
+
+			for (size_t i = 0; i < result.objects.size(); ++i) {
+				string object = basename + "." + to_string(i) + ".o";
+
+				result.errors += not restore(object, result.objects[i], false);
+				objects += object + " ";
+			}
+
+			// Relocatable object (-c) or executable
+			if (result.errors == 0 and system(NULL))
+				result.errors += sys(objflag ? "ld -r " + objects + "-o " + output : "clang " + objects + "-lm -o " + output) != 0;
+
+			for (size_t i = 0; i < result.objects.size(); ++i)
+				remove((basename + "." + to_string(i) + ".o").c_str());
+
+			if (result.errors == 0)
+				if (auto buffer = llvm::MemoryBuffer::getFile(output))
+					content = (*buffer)->getBuffer().str();
+		} else if (asmflag or objflag) // -S or -c
+			result.errors += not restore(output, content, false);
+		else {
+			// Write object file
+			result.errors += not restore(basename + ".o", content, false);
+
+			// Create executable
+			if (result.errors == 0 and system(NULL))
+				result.errors += sys("clang " + basename + ".o -lm -o " + basename) != 0;
+
+			remove((basename + ".o").c_str());
+
+			if (result.errors == 0)
+				if (auto buffer = llvm::MemoryBuffer::getFile(output))
+					content = (*buffer)->getBuffer().str();
+		}
+
+		if (cacheflag and result.errors == 0)
+			cache.store(content);
 	}
 
-	yyclose();
+	if (statsflag)
+		cache.stats(cerr);
+
+	return result.errors;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc > 1)
+		switch (hashflag(argv[1])) {
+			case server: { // -server[=<socket>]
+				// Warm up, such that requests don't pay for it
+				LLVMHelper("warmup").target();
+
+				string arg = argv[1];
+
+				return serve(arg.size() > 8 ? arg.substr(8) : "", compile, argv[0]);
+			}
+			case client: // -client=<socket>
+				return forward(string(argv[1]).substr(8), vector<string>(argv + 2, argv + argc));
+			default: break;
+		}
 
-	return yyerrs;
+	return compile(argc, argv);
 }
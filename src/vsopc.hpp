@@ -0,0 +1,145 @@
+#ifndef VSOPC_H
+#define VSOPC_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Mapping; // see mapping.hpp
+
+/**
+ * VSOP compiler library
+ *
+ * A compilation has no global state: it has its own scanner, parser, LLVM
+ * context and module, and its own output streams, such that several
+ * compilations can run concurrently, e.g. one per thread.
+ */
+namespace vsopc {
+	/// Last stage of a compilation
+	enum Stage {
+		LEX, // tokens (-lex)
+		PARSE, // abstract syntax tree (-parse)
+		CHECK, // annotated abstract syntax tree (-check)
+		LLVM, // LLVM intermediate representation (-llvm)
+		ASSEMBLY, // native assembly (-S)
+		OBJECT, // native object (-c)
+		RUN // just-in-time execution (-run)
+	};
+
+	/// Source file
+	struct Source {
+		std::string filename;
+		std::string text;
+
+		/**
+		 * Memory-mapped file, scanned in place instead of the text if set
+		 *
+		 * @warning A mapping is modified during the scan, it should not be shared by concurrent compilations.
+		 */
+		std::shared_ptr<Mapping> mapping;
+	};
+
+	/// Compilation options
+	struct Options {
+		Stage stage = OBJECT;
+
+		/// Extended VSOP (-ext)
+		bool ext = false;
+
+		/// Write the tokens as a binary token stream (-lex-bin, LEX stage), which can be compiled back as a source
+		bool binary = false;
+
+		/**
+		 * Write the parsed program as a binary abstract syntax tree to a file (-emit-ast), if no syntax error
+		 *
+		 * @note Such a file is loaded instead of parsed when given as a source (-load-ast), see serial.hpp.
+		 */
+		std::string ast_file;
+
+		/// Optimization levels (-O0 to -O3, -Os)
+		unsigned speed_level = 2, size_level = 0;
+
+		/// Target architecture and processor (-march, -mcpu)
+		std::string arch, cpu;
+
+		/// Name of the source, for error messages
+		std::string filename = "<source>";
+
+		/// Program arguments, starting with the program name (RUN)
+		std::vector<std::string> args;
+
+		/**
+		 * Number of worker threads (-jN)
+		 *
+		 * For multi-file programs, the sources are handled by a pool of threads (the number of cores if 0). For a
+		 * single source at the OBJECT stage, the module is split into as many partitions, emitted concurrently (not
+		 * split if 0 or 1).
+		 */
+		unsigned jobs = 0;
+
+		/**
+		 * Count the accesses to each field and append them to a file at exit (-field-layout-instrument)
+		 *
+		 * @note Such a file lays out the most accessed fields together when given as profile (-field-layout-profile).
+		 */
+		std::string field_instrument, field_profile;
+
+		/**
+		 * Allocate the objects on a garbage collected heap (-gc)
+		 *
+		 * @note The generated functions then maintain a shadow stack of their object and string values.
+		 */
+		bool gc = false;
+
+		/**
+		 * Time the phases (-time-phases) and trace them to a file (-trace)
+		 *
+		 * @warning LLVM timers and time profiler are process-wide, profiled compilations should not run concurrently.
+		 */
+		bool timing = false;
+		std::string trace;
+	};
+
+	/// Compilation result
+	struct Result {
+		/// Number of errors
+		int errors = 0;
+
+		/// Exit status of the program (RUN)
+		int status = 0;
+
+		/// Tokens, tree, intermediate representation, assembly or object code, depending on the stage
+		std::string output;
+
+		/// Object code of each source for multi-file programs, or of each partition of the module (OBJECT, -jN)
+		std::vector<std::string> objects;
+
+		/// Error messages
+		std::string diagnostics;
+	};
+
+	/**
+	 * Compile a source, writing the output and the error messages to streams
+	 *
+	 * @note The output is only written if there are no errors, except for the LEX, PARSE and CHECK stages.
+	 * @note With several jobs, the objects of the partitions are returned in the result instead (see Options::jobs).
+	 */
+	Result compile(const std::string& source, const Options& options, std::ostream& out, std::ostream& err);
+
+	/// Compile a source, the output and the error messages are returned in the result
+	Result compile(const std::string& source, const Options& options=Options());
+
+	/**
+	 * Compile a multi-file program, writing the output and the error messages to streams
+	 *
+	 * Sources are parsed concurrently and their declarations are merged into a single program. At the OBJECT stage,
+	 * each source is then generated, optimized and emitted in its own module by a pool of worker threads, and the
+	 * objects (the first one including the Object runtime) are to be linked together. Other stages use a single module.
+	 *
+	 * @note options.filename is ignored.
+	 */
+	Result compile(const std::vector<Source>& sources, const Options& options, std::ostream& out, std::ostream& err);
+}
+
+#endif